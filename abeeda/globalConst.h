@@ -22,8 +22,8 @@
 #ifndef _globalConst_h_included_
 #define _globalConst_h_included_
 
-#define     randDouble      ((double)rand() / (double)RAND_MAX)
 #define     maxNodes        256
+#define     stateWords      (maxNodes / 64)
 
 #define     numColors       2
 #define     maxRound        4
@@ -30,35 +30,22 @@
 #include <time.h>
 #include <iostream>
 #include <dirent.h>
+#include <unistd.h>
 
 #include "globalConst.h"
 #include "tHMM.h"
 #include "tAgent.h"
+#include "tPhylogeny.h"
+#include "tGenomeFile.h"
+#include "tGenomeArchive.h"
+#include "tCheckpoint.h"
+#include "tSelection.h"
+#include "tPopulationStore.h"
+#include "tIsland.h"
 #include "tGame.h"
-
-#include <sys/socket.h>       /*  socket definitions        */
-#include <sys/types.h>        /*  socket types              */
-#include <arpa/inet.h>        /*  inet (3) funtions         */
-#include <unistd.h>           /*  misc. UNIX functions      */
-
-#include "helper.h"           /*  our own helper functions  */
-
-#define ECHO_PORT          (2002)
-#define MAX_LINE           (100000)
-
-#define BUFLEN              512
-#define NPACK               10
-#define PORT                9930
-
-int       list_s;                /*  listening socket          */
-int       conn_s;                /*  connection socket         */
-short int port;                  /*  port number               */
-struct    sockaddr_in servaddr;  /*  socket address structure  */
-char      buffer[MAX_LINE];      /*  character buffer          */
-char     *endptr;                /*  for strtol()              */
-
-void    setupBroadcast(void);
-void    doBroadcast(string data);
+#include "tThreadPool.h"
+#include "tSelfCheck.h"
+#include "tRandom.h"
 
 using namespace std;
 
@@ -74,14 +61,72 @@ bool    track_best_brains           = false;
 int     track_best_brains_frequency = 25;
 bool    make_logic_table            = false;
 bool    make_dot                    = false;
+int     numThreads                  = 0;
+int     exactEvaluationLimit        = 64;
+int     checkpointFrequency         = 0;
+int     migrationFrequency          = 100;
+int     migrantsPerMigration        = 2;
+bool    steadyState                 = false;
+uint64_t runSeed                    = 0;
+
+// shared state for the parallel fitness evaluation of one generation
+struct tEvaluationContext{
+    vector<tAgent*> *agents;
+    tGame *game;
+};
+
+// shared state for the parallel construction of the next generation
+struct tReproductionContext{
+    vector<tAgent*> *parents;
+    vector<tAgent*> *offspring;
+    vector<int> *parentIndex;
+    vector<int> *immigrantIndex;
+    vector<vector<unsigned char> > *immigrants;
+    tAgent *slots;
+    int update;
+    int firstID;
+};
+
+// shared state of the asynchronous steady state mode. the phylogeny (and the
+// archive and the progress report) are not thread safe and are only touched
+// while holding phylogenyLock; the population itself is lock free.
+struct tSteadyStateContext{
+    tPopulationStore *store;
+    tPhylogeny *phylogeny;
+    tGenomeArchive *trackedBrains;
+    tSelection *selection;
+    tGame *game;
+    pthread_mutex_t phylogenyLock;
+    int64_t evaluations;
+    int64_t budget;
+    int nextID;
+    double startTime;
+    vector<vector<tAgent*> > freeAgents;
+    vector<vector<tAgent*> > ownedAgents;
+};
+
+void    evaluateAgent(int index, int thread, void *context);
+void    reproduceAgent(int index, int, void *context);
+void    steadyStateWorker(int index, int thread, void *context);
+void    runSteadyState(tSteadyStateContext &run, vector<tAgent*> &agents, tThreadPool *threadPool);
+void    retireReclaimed(tSteadyStateContext &run, int thread, vector<tAgent*> &reclaimed);
+double  secondsNow(void);
 
 int main(int argc, char *argv[])
 {
 	vector<tAgent*> gameAgents, GANextGen;
+    tPhylogeny phylogeny;
+    tSelection selection;
+    vector<double> fitnesses;
 	tAgent *gameAgent = NULL, *bestGameAgent = NULL;
 	double gameAgentMaxFitness = 0.0;
     string LODFileName = "", gameGenomeFileName = "", inputGenomeFileName = "";
     string gameDotFileName = "", logicTableFileName = "";
+    string checkpointFileName = "", resumeFileName = "";
+    bool selectionGiven = false;
+    tIsland island;
+    vector<string> islandPeers;
+    int islandIndex = -1;
     
     // initial object setup
     gameAgents.resize(populationSize);
@@ -89,7 +134,7 @@ int main(int argc, char *argv[])
 	gameAgent = new tAgent;
     
     // time-based seed by default. can change with command-line parameter.
-    srand((unsigned int)time(NULL));
+    runSeed = (uint64_t)time(NULL);
     
     for (int i = 1; i < argc; ++i)
     {
@@ -111,7 +156,7 @@ int main(int argc, char *argv[])
         else if (strcmp(argv[i], "-s") == 0 && (i + 1) < argc)
         {
             ++i;
-            srand(atoi(argv[i]));
+            runSeed = (uint64_t)atoi(argv[i]);
         }
         
         // -g [int]: set generations (default: 10000)
@@ -186,7 +231,7 @@ int main(int argc, char *argv[])
             }
         }
         
-        // -t [int]: track best brains
+        // -t [int]: track best brains in [genome file name].archive
         else if (strcmp(argv[i], "-t") == 0 && (i + 1) < argc)
         {
             track_best_brains = true;
@@ -200,6 +245,202 @@ int main(int argc, char *argv[])
             }
         }
         
+        // -nt [int]: number of threads used to evaluate the population (default: all cores)
+        else if (strcmp(argv[i], "-nt") == 0 && (i + 1) < argc)
+        {
+            ++i;
+            numThreads = atoi(argv[i]);
+            
+            if (numThreads < 1)
+            {
+                cerr << "minimum number of threads is 1." << endl;
+                exit(0);
+            }
+        }
+        
+        // -ex [int]: largest number of color sequences that are enumerated instead of sampled (default: 64)
+        else if (strcmp(argv[i], "-ex") == 0 && (i + 1) < argc)
+        {
+            ++i;
+            exactEvaluationLimit = atoi(argv[i]);
+            
+            if (exactEvaluationLimit < 0)
+            {
+                cerr << "minimum exact evaluation limit is 0." << endl;
+                exit(0);
+            }
+        }
+        
+        // -sel [roulette|tournament|truncation]: parent selection method (default: roulette)
+        else if (strcmp(argv[i], "-sel") == 0 && (i + 1) < argc)
+        {
+            ++i;
+            selectionGiven = true;
+            
+            if (strcmp(argv[i], "roulette") == 0)
+            {
+                selection.method = SELECTION_ROULETTE;
+            }
+            else if (strcmp(argv[i], "tournament") == 0)
+            {
+                selection.method = SELECTION_TOURNAMENT;
+            }
+            else if (strcmp(argv[i], "truncation") == 0)
+            {
+                selection.method = SELECTION_TRUNCATION;
+            }
+            else
+            {
+                cerr << "unknown selection method " << argv[i] << "." << endl;
+                exit(0);
+            }
+        }
+        
+        // -ts [int]: tournament size (default: 2)
+        else if (strcmp(argv[i], "-ts") == 0 && (i + 1) < argc)
+        {
+            ++i;
+            selection.tournamentSize = atoi(argv[i]);
+            
+            if (selection.tournamentSize < 1)
+            {
+                cerr << "minimum tournament size is 1." << endl;
+                exit(0);
+            }
+        }
+        
+        // -tf [double]: fraction of the population kept by truncation selection (default: 0.5)
+        else if (strcmp(argv[i], "-tf") == 0 && (i + 1) < argc)
+        {
+            ++i;
+            selection.truncationFraction = atof(argv[i]);
+            
+            if (selection.truncationFraction <= 0 || selection.truncationFraction > 1)
+            {
+                cerr << "truncation fraction must be above 0.0 and at most 1.0." << endl;
+                exit(0);
+            }
+        }
+        
+        // -async: steady state evolution without generations. every thread keeps
+        // breeding, evaluating and inserting offspring on its own; -g then counts
+        // populationSize evaluations as one generation. parents are always
+        // picked by tournament (-ts)
+        else if (strcmp(argv[i], "-async") == 0)
+        {
+            steadyState = true;
+        }
+        
+        // -c [int] [file name]: write a checkpoint every [int] generations
+        else if (strcmp(argv[i], "-c") == 0 && (i + 2) < argc)
+        {
+            ++i;
+            checkpointFrequency = atoi(argv[i]);
+            
+            if (checkpointFrequency < 1)
+            {
+                cerr << "minimum checkpoint frequency is 1." << endl;
+                exit(0);
+            }
+            
+            ++i;
+            checkpointFileName = argv[i];
+        }
+        
+        // -r [file name]: resume the run saved in a checkpoint. the run keeps the
+        // settings it was started with; only -nt may differ.
+        else if (strcmp(argv[i], "-r") == 0 && (i + 1) < argc)
+        {
+            ++i;
+            resumeFileName = argv[i];
+        }
+        
+        // -island [int] [host:port,host:port,...]: run as island [int] (counting
+        // from 0) of an island model. every island is one process and listens on
+        // its own address; migrants go from each island to the next on the list
+        else if (strcmp(argv[i], "-island") == 0 && (i + 2) < argc)
+        {
+            ++i;
+            islandIndex = atoi(argv[i]);
+            ++i;
+            
+            if (!tIsland::parsePeers(argv[i], islandPeers) || islandIndex < 0 || islandIndex >= (int)islandPeers.size())
+            {
+                cerr << "-island needs the index of this island and a list of host:port, one per island." << endl;
+                exit(0);
+            }
+        }
+        
+        // -mig [int] [int]: send the [int] fittest agents to the next island every [int] generations (default: 2 every 100)
+        else if (strcmp(argv[i], "-mig") == 0 && (i + 2) < argc)
+        {
+            ++i;
+            migrantsPerMigration = atoi(argv[i]);
+            ++i;
+            migrationFrequency = atoi(argv[i]);
+            
+            if (migrantsPerMigration < 0 || migrationFrequency < 1)
+            {
+                cerr << "minimum number of migrants is 0, minimum migration frequency is 1." << endl;
+                exit(0);
+            }
+        }
+        
+        // -tobin [in file name] [out file name]: convert a genome file to the binary format
+        else if (strcmp(argv[i], "-tobin") == 0 && (i + 2) < argc)
+        {
+            vector<unsigned char> genome;
+            
+            if (!tGenomeFile::load(argv[i + 1], genome) || !tGenomeFile::saveBinary(argv[i + 2], genome.empty() ? NULL : &genome[0], genome.size()))
+            {
+                cerr << "could not convert " << argv[i + 1] << " to " << argv[i + 2] << "." << endl;
+                exit(1);
+            }
+            
+            exit(0);
+        }
+        
+        // -totext [in file name] [out file name]: convert a genome file to the tab separated format
+        else if (strcmp(argv[i], "-totext") == 0 && (i + 2) < argc)
+        {
+            vector<unsigned char> genome;
+            
+            if (!tGenomeFile::load(argv[i + 1], genome) || !tGenomeFile::saveText(argv[i + 2], genome.empty() ? NULL : &genome[0], genome.size()))
+            {
+                cerr << "could not convert " << argv[i + 1] << " to " << argv[i + 2] << "." << endl;
+                exit(1);
+            }
+            
+            exit(0);
+        }
+        
+        // -x [archive file name] [int] [out file name]: extract the genome tracked in the given generation
+        else if (strcmp(argv[i], "-x") == 0 && (i + 3) < argc)
+        {
+            tGenomeArchive archive;
+            vector<unsigned char> genome;
+            int entry = -1;
+            
+            if (archive.open(argv[i + 1]))
+            {
+                entry = archive.find(atoi(argv[i + 2]));
+            }
+            
+            if (entry < 0 || !archive.load(entry, genome) || !tGenomeFile::saveText(argv[i + 3], genome.empty() ? NULL : &genome[0], genome.size()))
+            {
+                cerr << "could not extract generation " << argv[i + 2] << " from " << argv[i + 1] << "." << endl;
+                exit(1);
+            }
+            
+            exit(0);
+        }
+        
+        // -check: run the regression checks; scratch files go to the current directory
+        else if (strcmp(argv[i], "-check") == 0)
+        {
+            exit(tSelfCheck::runAll() ? 0 : 1);
+        }
+        
         // -lt [in file name] [out file name]: create logic table for given genome
         else if (strcmp(argv[i], "-lt") == 0 && (i + 2) < argc)
         {
@@ -239,28 +480,198 @@ int main(int argc, char *argv[])
         exit(0);
     }
     
-    // seed the agents
-    delete gameAgent;
-    gameAgent = new tAgent;
-    gameAgent->setupRandomAgent(5000);
-    //gameAgent->loadAgent((char *)"gameAgent.genome");
+    if (steadyState && (checkpointFrequency > 0 || resumeFileName != ""))
+    {
+        cerr << "checkpoints are not available in the steady state mode." << endl;
+        exit(0);
+    }
     
-    // make mutated copies of the start genome to fill up the initial population
-	for(int i = 0; i < populationSize; ++i)
+    // roulette and truncation rank the whole population, which the steady
+    // state mode never holds still long enough to do
+    if (steadyState && selectionGiven && selection.method != SELECTION_TOURNAMENT)
+    {
+        cerr << "the steady state mode only selects by tournament." << endl;
+        exit(0);
+    }
+    
+    if (islandIndex >= 0 && (steadyState || checkpointFrequency > 0 || resumeFileName != ""))
+    {
+        cerr << "the island model runs neither in the steady state mode nor with checkpoints." << endl;
+        exit(0);
+    }
+    
+    // islands started with the same seed must not all evolve alike
+    if (islandIndex >= 0)
+    {
+        runSeed += (uint64_t)islandIndex;
+    }
+    
+    tCheckpoint resumeCheckpoint;
+    int firstUpdate = 1;
+    
+    // a resumed run takes its settings from the checkpoint before anything
+    // is sized by them
+    if (resumeFileName != "")
+    {
+        if (!resumeCheckpoint.load(resumeFileName.c_str()))
+        {
+            cerr << "could not read checkpoint " << resumeFileName << "." << endl;
+            exit(1);
+        }
+        
+        firstUpdate = resumeCheckpoint.getInt() + 1;
+        runSeed = resumeCheckpoint.getUInt64();
+        populationSize = resumeCheckpoint.getInt();
+        totalGenerations = resumeCheckpoint.getInt();
+        perSitePointMutationRate = resumeCheckpoint.getDouble();
+        duplicationMutationRate = resumeCheckpoint.getDouble();
+        deletionMutationRate = resumeCheckpoint.getDouble();
+        exactEvaluationLimit = resumeCheckpoint.getInt();
+        selection.method = resumeCheckpoint.getInt();
+        selection.tournamentSize = resumeCheckpoint.getInt();
+        selection.truncationFraction = resumeCheckpoint.getDouble();
+        track_best_brains = resumeCheckpoint.getInt() != 0;
+        track_best_brains_frequency = resumeCheckpoint.getInt();
+        checkpointFrequency = resumeCheckpoint.getInt();
+        checkpointFileName = resumeCheckpoint.getString();
+        LODFileName = resumeCheckpoint.getString();
+        gameGenomeFileName = resumeCheckpoint.getString();
+        
+        if (resumeCheckpoint.failed || populationSize < 2)
+        {
+            cerr << "checkpoint " << resumeFileName << " is damaged." << endl;
+            exit(1);
+        }
+        
+        gameAgents.resize(populationSize);
+    }
+    
+    // seed the agents; a resumed run takes them from the checkpoint instead
+    if (resumeFileName == "")
+    {
+        delete gameAgent;
+        gameAgent = new tAgent;
+        gameAgent->rng = tRandom::stream(runSeed, RNG_SETUP, 0, populationSize);
+        gameAgent->setupRandomAgent(5000);
+        //gameAgent->loadAgent((char *)"gameAgent.genome");
+        
+        // the line of descent is streamed to the LOD file as it becomes fixed
+        if (LODFileName != "")
+        {
+            phylogeny.openLineageFile(LODFileName.c_str());
+        }
+        gameAgent->info->phylogenyNode = phylogeny.addRoot(gameAgent->info->genome.bytes(), gameAgent->info->ID, 0);
+    }
+    
+    // two generations of agents live in one contiguous array: the initial
+    // population fills the first half and the offspring of generation u are
+    // written into half (u & 1), over the agents of generation u - 2
+    tAgent *agentStore = new tAgent[2 * populationSize];
+    
+    if (resumeFileName != "")
+    {
+        long lineageLength;
+        
+        tAgent::setNextID(resumeCheckpoint.getInt());
+        phylogeny.loadState(resumeCheckpoint);
+        lineageLength = (long)resumeCheckpoint.getUInt64();
+        
+        // the population of the checkpointed generation sits in the half its
+        // offspring would have been written to
+        for(int i = 0; i < populationSize; ++i)
+        {
+            gameAgents[i] = &agentStore[((firstUpdate - 1) & 1) * populationSize + i];
+            gameAgents[i]->loadState(resumeCheckpoint);
+        }
+        
+        if (resumeCheckpoint.failed)
+        {
+            cerr << "checkpoint " << resumeFileName << " is damaged." << endl;
+            exit(1);
+        }
+        
+        if (LODFileName != "")
+        {
+            phylogeny.reopenLineageFile(LODFileName.c_str(), lineageLength);
+        }
+        
+        delete gameAgent;
+        gameAgent = NULL;
+        resumeCheckpoint.clear();
+    }
+    else
     {
-		gameAgents[i] = new tAgent;
-		gameAgents[i]->inherit(gameAgent, 0.01, duplicationMutationRate, deletionMutationRate, 0);
+        // make mutated copies of the start genome to fill up the initial population
+        for(int i = 0; i < populationSize; ++i)
+        {
+            gameAgents[i] = &agentStore[i];
+            gameAgents[i]->rng = tRandom::stream(runSeed, RNG_SETUP, 0, i);
+            gameAgents[i]->inherit(gameAgent, 0.01, duplicationMutationRate, deletionMutationRate, 0);
+            gameAgents[i]->info->phylogenyNode = phylogeny.addChild(gameAgent->info->phylogenyNode, gameAgents[i]->info->delta, gameAgents[i]->info->ID, 0, gameAgents[i]->info->genome.size());
+        }
+        
+        phylogeny.retire(gameAgent->info->phylogenyNode);
+        delete gameAgent;
+        gameAgent = NULL;
     }
     
 	GANextGen.resize(populationSize);
+    fitnesses.resize(populationSize);
+    
+    if (numThreads == 0)
+    {
+        numThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    
+    // the tracked brains of the whole run go into one archive
+    tGenomeArchive trackedBrains;
+    
+    if (track_best_brains && !(resumeFileName != "" ? trackedBrains.resume((gameGenomeFileName + ".archive").c_str(), firstUpdate - 1) : trackedBrains.create((gameGenomeFileName + ".archive").c_str())))
+    {
+        cerr << "could not create " << gameGenomeFileName << ".archive." << endl;
+        exit(1);
+    }
     
-	gameAgent->nrPointingAtMe--;
+    tCheckpointWriter checkpointWriter;
+    tThreadPool *threadPool = new tThreadPool(numThreads);
+    tEvaluationContext evaluationContext;
+    evaluationContext.agents = &gameAgents;
+    evaluationContext.game = game;
+    
+    vector<int> parentIndex(populationSize);
+    vector<double> evaluationCosts(populationSize), reproductionCosts(populationSize);
+    vector<int> immigrantIndex(populationSize, -1), fittest(populationSize);
+    vector<vector<unsigned char> > emigrants, immigrants;
+    tReproductionContext reproductionContext;
+    reproductionContext.parents = &gameAgents;
+    reproductionContext.offspring = &GANextGen;
+    reproductionContext.parentIndex = &parentIndex;
+    reproductionContext.immigrantIndex = &immigrantIndex;
+    reproductionContext.immigrants = &immigrants;
+    reproductionContext.slots = agentStore;
+    
+    if (islandIndex >= 0 && !island.start(islandIndex, islandPeers))
+    {
+        cerr << "could not listen on " << islandPeers[islandIndex] << " or look up the next island." << endl;
+        exit(1);
+    }
     
 	cout << "setup complete" << endl;
     cout << "starting evolution" << endl;
     
+    tSteadyStateContext steadyStateContext;
+    
+    if (steadyState)
+    {
+        steadyStateContext.phylogeny = &phylogeny;
+        steadyStateContext.trackedBrains = &trackedBrains;
+        steadyStateContext.selection = &selection;
+        steadyStateContext.game = game;
+        runSteadyState(steadyStateContext, gameAgents, threadPool);
+    }
+    
     // main loop
-	for (int update = 1; update <= totalGenerations; ++update)
+	for (int update = firstUpdate; !steadyState && update <= totalGenerations; ++update)
     {
         // reset fitnesses
 		for(int i = 0; i < populationSize; ++i)
@@ -273,20 +684,26 @@ int main(int argc, char *argv[])
 		gameAgentMaxFitness = 0.0;
         double gameAgentAvgFitness = 0.0;
         
+        // every agent gets its own stream for this generation, so the outcome
+        // does not depend on which thread ends up evaluating which agent
+        for(int i = 0; i < populationSize; ++i)
+        {
+            gameAgents[i]->rng = tRandom::stream(runSeed, RNG_EVALUATION, update, i);
+        }
+        
+        // the threads start on blocks of equal estimated cost
+        for(int i = 0; i < populationSize; ++i)
+        {
+            evaluationCosts[i] = game->evaluationCost(gameAgents[i], 10, exactEvaluationLimit);
+        }
+        
+        threadPool->parallelFor(populationSize, &evaluateAgent, &evaluationContext, evaluationCosts);
+        
 		for(int i = 0; i < populationSize; ++i)
         {
-            double gameAgentFitness = 0.0;
-            
-            for (int j = 0; j < 10; ++j)
-            {
-                game->executeGame(gameAgents[i], NULL, false);
-                //gameAgents[i]->fitnesses.push_back(gameAgents[i]->fitness);
-                gameAgentFitness += gameAgents[i]->fitness;
-            }
-            
-            gameAgents[i]->fitness = gameAgentFitness / 10.0;
-            
             gameAgentAvgFitness += gameAgents[i]->fitness;
+            fitnesses[i] = gameAgents[i]->fitness;
+            phylogeny.setFitness(gameAgents[i]->info->phylogenyNode, gameAgents[i]->fitness);
             
             if(gameAgents[i]->fitness > gameAgentMaxFitness)
             {
@@ -296,53 +713,187 @@ int main(int argc, char *argv[])
 		}
         
         gameAgentAvgFitness /= (double)populationSize;
+        selection.prepare(fitnesses);
 		
         if (update % 1000 == 0)
         {
             cout << "generation " << update << ": game agent [" << gameAgentAvgFitness << " : " << gameAgentMaxFitness << "]" << endl;
         }
         
+        // the fittest agents go to the next island, and whatever came in from
+        // the previous one since the last migration takes the place of random
+        // offspring. neither waits for the other island.
+        immigrants.clear();
+        fill(immigrantIndex.begin(), immigrantIndex.end(), -1);
+        
+        if (islandIndex >= 0 && update % migrationFrequency == 0)
+        {
+            int migrants = min(migrantsPerMigration, populationSize);
+            tFitterFirst fitterFirst;
+            tRandom migrationRNG = tRandom::stream(runSeed, RNG_MIGRATION, update, 0);
+            
+            for(int i = 0; i < populationSize; ++i)
+            {
+                fittest[i] = i;
+            }
+            
+            fitterFirst.fitness = &fitnesses;
+            partial_sort(fittest.begin(), fittest.begin() + migrants, fittest.end(), fitterFirst);
+            emigrants.resize(migrants);
+            
+            for(int i = 0; i < migrants; ++i)
+            {
+                emigrants[i] = gameAgents[fittest[i]]->info->genome.bytes();
+            }
+            
+            island.send(update, emigrants);
+            island.receive(immigrants, migrants);
+            
+            // the slots the immigrants take, drawn without replacement
+            for(int i = 0; i < populationSize; ++i)
+            {
+                fittest[i] = i;
+            }
+            
+            for(int i = 0; i < (int)immigrants.size(); ++i)
+            {
+                swap(fittest[i], fittest[i + (int)migrationRNG.nextInt((unsigned int)(populationSize - i))]);
+                immigrantIndex[fittest[i]] = i;
+            }
+        }
+        
+        // construct the population of the next generation. every offspring only
+        // reads the parents and writes its own slot, so they are built in
+        // parallel; IDs and random streams are fixed by the offspring's index,
+        // so the result does not depend on the number of threads
+        reproductionContext.update = update;
+        reproductionContext.firstID = tAgent::nextID();
+        tAgent::setNextID(reproductionContext.firstID + populationSize);
+        
+        // parents are picked up front, so that building an offspring's
+        // phenotype can be costed by the size of its parent's genome.
+        // selection and mutation of offspring i use the same stream.
+        for(int i = 0; i < populationSize; ++i)
+        {
+            tAgent *offspring = &agentStore[(update & 1) * populationSize + i];
+            
+            offspring->rng = tRandom::stream(runSeed, RNG_REPRODUCTION, update, i);
+            
+            if (immigrantIndex[i] >= 0)
+            {
+                parentIndex[i] = -1;
+                reproductionCosts[i] = (double)immigrants[immigrantIndex[i]].size();
+                continue;
+            }
+            
+            parentIndex[i] = selection.select(i, offspring->rng);
+            reproductionCosts[i] = (double)gameAgents[parentIndex[i]]->info->genome.size();
+        }
+        
+        threadPool->parallelFor(populationSize, &reproduceAgent, &reproductionContext, reproductionCosts);
+        
+        // the phylogeny is updated in offspring order, as a serial run would
 		for(int i = 0; i < populationSize; ++i)
 		{
-            // construct swarm agent population for the next generation
-			tAgent *offspring = new tAgent;
-            int j = 0;
+            tAgent *offspring = GANextGen[i];
             
-			do
+            if (parentIndex[i] < 0)
             {
-                j = rand() % populationSize;
-            } while((j == i) || (randDouble > (gameAgents[j]->fitness / gameAgentMaxFitness)));
+                offspring->info->phylogenyNode = phylogeny.addImmigrant(offspring->info->delta, offspring->info->ID, update, offspring->info->genome.size());
+                continue;
+            }
             
-			offspring->inherit(gameAgents[j], perSitePointMutationRate, duplicationMutationRate, deletionMutationRate, update);
-			GANextGen[i] = offspring;
+            offspring->info->phylogenyNode = phylogeny.addChild(gameAgents[parentIndex[i]]->info->phylogenyNode, offspring->info->delta, offspring->info->ID, update, offspring->info->genome.size());
 		}
         
 		for(int i = 0; i < populationSize; ++i)
         {
-            // retire and replace the game agents from the previous generation
+            // retire and replace the game agents from the previous generation;
+            // their slots are overwritten by the offspring of the next one and
+            // only their node in the phylogeny outlives them
 			gameAgents[i]->retire();
-			gameAgents[i]->nrPointingAtMe--;
-			if(gameAgents[i]->nrPointingAtMe == 0)
-            {
-				delete gameAgents[i];
-            }
+            phylogeny.retire(gameAgents[i]->info->phylogenyNode);
 			gameAgents[i] = GANextGen[i];
 		}
         
 		gameAgents = GANextGen;
+        phylogeny.coalesce();
         
         if (track_best_brains && update % track_best_brains_frequency == 0)
         {
-            stringstream sss;
+            vector<unsigned char> trackedGenome;
+            
+            phylogeny.rebuildGenome(phylogeny.getAncestor(gameAgents[0]->info->phylogenyNode, 2), trackedGenome);
+            trackedBrains.append(update, trackedGenome);
+        }
+        
+        // the checkpoint is filled here and written out by its own thread
+        // while the next generations run
+        if (checkpointFrequency > 0 && update % checkpointFrequency == 0)
+        {
+            tCheckpoint &checkpoint = checkpointWriter.next();
             
-            sss << "gameAgent" << update << ".genome";
+            checkpoint.putInt(update);
+            checkpoint.putUInt64(runSeed);
+            checkpoint.putInt(populationSize);
+            checkpoint.putInt(totalGenerations);
+            checkpoint.putDouble(perSitePointMutationRate);
+            checkpoint.putDouble(duplicationMutationRate);
+            checkpoint.putDouble(deletionMutationRate);
+            checkpoint.putInt(exactEvaluationLimit);
+            checkpoint.putInt(selection.method);
+            checkpoint.putInt(selection.tournamentSize);
+            checkpoint.putDouble(selection.truncationFraction);
+            checkpoint.putInt(track_best_brains ? 1 : 0);
+            checkpoint.putInt(track_best_brains_frequency);
+            checkpoint.putInt(checkpointFrequency);
+            checkpoint.putString(checkpointFileName);
+            checkpoint.putString(LODFileName);
+            checkpoint.putString(gameGenomeFileName);
+            checkpoint.putInt(tAgent::nextID());
+            phylogeny.saveState(checkpoint);
+            checkpoint.putUInt64((uint64_t)phylogeny.lineageLength());
             
-            gameAgents[0]->ancestor->ancestor->saveGenome(sss.str().c_str());
+            for(int i = 0; i < populationSize; ++i)
+            {
+                gameAgents[i]->saveState(checkpoint);
+            }
+            
+            checkpointWriter.submit(checkpointFileName);
         }
 	}
 	
+    // how evenly the work was spread over the threads
+    if (threadPool->size() > 1)
+    {
+        for (int t = 0; t < threadPool->size(); ++t)
+        {
+            tWorkerStats stats = threadPool->stats(t);
+            
+            cout << "thread " << t << ": " << 100.0 * threadPool->utilisation(t) << "% busy, " << stats.tasks << " tasks, " << stats.stolen << " stolen" << endl;
+        }
+    }
+    
+    if (islandIndex >= 0)
+    {
+        island.stop();
+        cout << "island " << islandIndex << ": " << island.sent << " migrants sent, " << island.received << " received, " << island.dropped << " dropped" << endl;
+    }
+    
+    delete threadPool;
+    checkpointWriter.finish();
+    
     // save the genome file of the lmrca
-	gameAgents[0]->ancestor->ancestor->saveGenome(gameGenomeFileName.c_str());
+    phylogeny.saveGenome(phylogeny.getAncestor(gameAgents[0]->info->phylogenyNode, 2), gameGenomeFileName.c_str());
+    delete[] agentStore;
+    
+    for (int t = 0; steadyState && t < (int)steadyStateContext.ownedAgents.size(); ++t)
+    {
+        for (int i = 0; i < (int)steadyStateContext.ownedAgents[t].size(); ++i)
+        {
+            delete steadyStateContext.ownedAgents[t][i];
+        }
+    }
     
     // save quantitative stats on the best game agent's LOD
     /*vector<tAgent*> saveLOD;
@@ -380,41 +931,240 @@ int main(int argc, char *argv[])
     return 0;
 }
 
-void setupBroadcast(void)
+// determines the fitness of one agent; called concurrently from the thread pool.
+// deterministic brains are scored exactly over all color sequences when there are few enough
+// of them, all others play 10 random games side by side in one bit-sliced batch.
+void evaluateAgent(int index, int, void *context)
 {
-    port = ECHO_PORT;
-	if ( (list_s = socket(AF_INET, SOCK_STREAM, 0)) < 0 )
+    tEvaluationContext *evaluation = (tEvaluationContext*)context;
+    tAgent *agent = (*evaluation->agents)[index];
+    
+    agent->fitness = evaluation->game->evaluateAgent(agent, 10, exactEvaluationLimit);
+}
+
+void reproduceAgent(int index, int, void *context)
+{
+    tReproductionContext *reproduction = (tReproductionContext*)context;
+    tAgent *offspring = &reproduction->slots[(reproduction->update & 1) * populationSize + index];
+    
+    // resetting leaves the random stream the parent was selected with
+    offspring->resetAgent(reproduction->firstID + index);
+    
+    if ((*reproduction->immigrantIndex)[index] >= 0)
     {
-		fprintf(stderr, "ECHOSERV: Error creating listening socket.\n");
+        offspring->immigrate((*reproduction->immigrants)[(*reproduction->immigrantIndex)[index]], reproduction->update);
     }
-	/*  Set all bytes in socket address structure to
-	 zero, and fill in the relevant data members   */
-    memset(&servaddr, 0, sizeof(servaddr));
-    servaddr.sin_family      = AF_INET;
-    servaddr.sin_addr.s_addr = htonl(INADDR_ANY);
-    servaddr.sin_port        = htons(port);
-	/*  Bind our socket addresss to the 
-	 listening socket, and call listen()  */
-    if ( bind(list_s, (struct sockaddr *) &servaddr, sizeof(servaddr)) < 0 )
+    else
     {
-		fprintf(stderr, "ECHOSERV: Error calling bind()\n");
+        offspring->inherit((*reproduction->parents)[(*reproduction->parentIndex)[index]], perSitePointMutationRate, duplicationMutationRate, deletionMutationRate, reproduction->update);
     }
-    if ( listen(list_s, LISTENQ) < 0 )
+    
+    (*reproduction->offspring)[index] = offspring;
+}
+
+// evaluates the initial population, then lets every thread of the pool run
+// steadyStateWorker until populationSize * totalGenerations offspring have
+// been evaluated. agents leaves with the final population.
+void runSteadyState(tSteadyStateContext &run, vector<tAgent*> &agents, tThreadPool *threadPool)
+{
+    tEvaluationContext evaluationContext;
+    tPopulationStore store(populationSize, threadPool->size());
+    vector<tAgent*> reclaimed;
+    double seconds;
+    
+    evaluationContext.agents = &agents;
+    evaluationContext.game = run.game;
+    
+    for(int i = 0; i < populationSize; ++i)
+    {
+        agents[i]->rng = tRandom::stream(runSeed, RNG_EVALUATION, 0, i);
+    }
+    
+    vector<double> costs(populationSize);
+    
+    for(int i = 0; i < populationSize; ++i)
     {
-		fprintf(stderr, "ECHOSERV: Error calling listen()\n");
+        costs[i] = run.game->evaluationCost(agents[i], 10, exactEvaluationLimit);
     }
+    
+    threadPool->parallelFor(populationSize, &evaluateAgent, &evaluationContext, costs);
+    
+    for(int i = 0; i < populationSize; ++i)
+    {
+        run.phylogeny->setFitness(agents[i]->info->phylogenyNode, agents[i]->fitness);
+        store.set(i, agents[i]);
+    }
+    
+    run.store = &store;
+    pthread_mutex_init(&run.phylogenyLock, NULL);
+    run.evaluations = 0;
+    run.budget = (int64_t)populationSize * totalGenerations;
+    run.nextID = tAgent::nextID();
+    run.freeAgents.resize(threadPool->size());
+    run.ownedAgents.resize(threadPool->size());
+    run.startTime = secondsNow();
+    
+    threadPool->parallelFor(threadPool->size(), &steadyStateWorker, &run);
+    
+    seconds = secondsNow() - run.startTime;
+    
+    // every thread is offline now, so whatever is still waiting can go
+    for (int t = 0; t < threadPool->size(); ++t)
+    {
+        store.reclaim(t, reclaimed);
+        retireReclaimed(run, t, reclaimed);
+    }
+    
+    for(int i = 0; i < populationSize; ++i)
+    {
+        agents[i] = store.get(i);
+    }
+    
+    tAgent::setNextID(run.nextID);
+    pthread_mutex_destroy(&run.phylogenyLock);
+    
+    cout << run.budget << " evaluations in " << seconds << " s (" << ((seconds > 0.0) ? (double)run.budget / seconds : 0.0) << " evaluations/s)" << endl;
 }
 
-void doBroadcast(string data)
+// one thread of the steady state mode: pick a parent by tournament, breed and
+// evaluate an offspring and let it replace the less fit of two random members
+void steadyStateWorker(int, int thread, void *context)
 {
-    if ( (conn_s = accept(list_s, NULL, NULL) ) < 0 )
+    tSteadyStateContext *run = (tSteadyStateContext*)context;
+    tPopulationStore *store = run->store;
+    int n = store->size();
+    vector<tAgent*> reclaimed;
+    int64_t e;
+    
+    store->online(thread);
+    
+    while ((e = __sync_fetch_and_add(&run->evaluations, 1)) < run->budget)
     {
-        fprintf(stderr, "ECHOSERV: Error calling accept()\n");
+        tAgent *offspring, *parent, *victim;
+        int slot;
+        
+        if (run->freeAgents[thread].empty())
+        {
+            // the constructor draws an ID from the shared counter
+            pthread_mutex_lock(&run->phylogenyLock);
+            offspring = new tAgent;
+            pthread_mutex_unlock(&run->phylogenyLock);
+            run->ownedAgents[thread].push_back(offspring);
+        }
+        else
+        {
+            offspring = run->freeAgents[thread].back();
+            run->freeAgents[thread].pop_back();
+        }
+        
+        offspring->resetAgent(__sync_fetch_and_add(&run->nextID, 1));
+        offspring->rng = tRandom::stream(runSeed, RNG_STEADY_STATE, e, 0);
+        
+        parent = store->get(offspring->rng.nextInt(n));
+        
+        for (int t = 1; t < run->selection->tournamentSize; ++t)
+        {
+            tAgent *challenger = store->get(offspring->rng.nextInt(n));
+            
+            if (challenger->fitness > parent->fitness)
+            {
+                parent = challenger;
+            }
+        }
+        
+        offspring->inherit(parent, perSitePointMutationRate, duplicationMutationRate, deletionMutationRate, (int)(e / n));
+        offspring->rng = tRandom::stream(runSeed, RNG_STEADY_STATE, e, 1);
+        offspring->fitness = run->game->evaluateAgent(offspring, 10, exactEvaluationLimit);
+        
+        // the parent cannot have been reclaimed yet, this thread has not been
+        // quiescent since it picked it, so its phylogeny node is still there
+        pthread_mutex_lock(&run->phylogenyLock);
+        offspring->info->phylogenyNode = run->phylogeny->addChild(parent->info->phylogenyNode, offspring->info->delta, offspring->info->ID, (int)(e / n), offspring->info->genome.size());
+        run->phylogeny->setFitness(offspring->info->phylogenyNode, offspring->fitness);
+        pthread_mutex_unlock(&run->phylogenyLock);
+        
+        do
+        {
+            int a = (int)offspring->rng.nextInt(n);
+            int b = (int)offspring->rng.nextInt(n);
+            tAgent *first = store->get(a);
+            tAgent *second = store->get(b);
+            
+            slot = (second->fitness < first->fitness) ? b : a;
+            victim = (slot == b) ? second : first;
+        } while (!store->replace(slot, victim, offspring));
+        
+        store->retire(thread, victim);
+        
+        if ((e + 1) % n == 0)
+        {
+            int update = (int)((e + 1) / n);
+            
+            pthread_mutex_lock(&run->phylogenyLock);
+            
+            if (track_best_brains && update % track_best_brains_frequency == 0)
+            {
+                vector<unsigned char> trackedGenome;
+                
+                run->phylogeny->rebuildGenome(run->phylogeny->getAncestor(store->get(0)->info->phylogenyNode, 2), trackedGenome);
+                run->trackedBrains->append(update, trackedGenome);
+            }
+            
+            if (update % 1000 == 0)
+            {
+                double average = 0.0, maximum = 0.0;
+                double seconds = secondsNow() - run->startTime;
+                
+                for (int i = 0; i < n; ++i)
+                {
+                    double fitness = store->get(i)->fitness;
+                    
+                    average += fitness;
+                    maximum = max(maximum, fitness);
+                }
+                
+                cout << "generation " << update << ": game agent [" << average / (double)n << " : " << maximum << "] " << ((seconds > 0.0) ? (double)(e + 1) / seconds : 0.0) << " evaluations/s" << endl;
+            }
+            
+            pthread_mutex_unlock(&run->phylogenyLock);
+        }
+        
+        store->quiescent(thread);
+        store->reclaim(thread, reclaimed);
+        retireReclaimed(*run, thread, reclaimed);
+    }
+    
+    store->offline(thread);
+}
+
+// agents nobody can see anymore leave the phylogeny and are kept for reuse
+void retireReclaimed(tSteadyStateContext &run, int thread, vector<tAgent*> &reclaimed)
+{
+    if (reclaimed.empty())
+    {
+        return;
     }
-    Writeline(conn_s, data.c_str(), data.length());
     
-    if ( close(conn_s) < 0 )
+    pthread_mutex_lock(&run.phylogenyLock);
+    
+    for (int i = 0; i < (int)reclaimed.size(); ++i)
     {
-        fprintf(stderr, "ECHOSERV: Error calling close()\n");
+        reclaimed[i]->retire();
+        run.phylogeny->retire(reclaimed[i]->info->phylogenyNode);
     }
+    
+    run.phylogeny->coalesce();
+    pthread_mutex_unlock(&run.phylogenyLock);
+    
+    run.freeAgents[thread].insert(run.freeAgents[thread].end(), reclaimed.begin(), reclaimed.end());
+    reclaimed.clear();
+}
+
+double secondsNow(void)
+{
+    struct timespec now;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    return (double)now.tv_sec + 1e-9 * (double)now.tv_nsec;
 }
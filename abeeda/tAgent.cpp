@@ -23,372 +23,529 @@
 #include <stdlib.h>
 #include <map>
 #include <math.h>
+#include <algorithm>
 #include "tAgent.h"
+#include "tCodonScanner.h"
+#include "tGenomeFile.h"
+#include "tCheckpoint.h"
+
+static int masterID = 0;
 
 tAgent::tAgent(){
-	nrPointingAtMe=1;
-	ancestor = NULL;
-	for(int i=0;i<maxNodes;i++)
+	info=new tAgentInfo;
+	info->gateParser=NULL;
+	resetAgent();
+}
+
+// puts a recycled agent back into the state of a newly constructed one. the
+// genome and brain keep their buffers, so refilling them does not allocate.
+void tAgent::resetAgent(void)
+{
+	resetAgent(masterID++);
+}
+
+// the same with the ID handed in, for agents that are reset on several
+// threads at once and still need the IDs of a serial run
+void tAgent::resetAgent(int ID)
+{
+	for(int i=0;i<stateWords;i++)
     {
-		states[i]=0;
-		newStates[i]=0;
+		stateBuffers[0][i]=0;
+		stateBuffers[1][i]=0;
 	}
-	bestSteps=-1;
-	ID=masterID;
-	masterID++;
-	saved=false;
-	hmmus.clear();
-	nrOfOffspring=0;
-	retired=false;
-	food=0;
+	currentStates=0;
+	phenotypeValid=false;
     totalSteps=0;
-#ifdef useANN
-	ANN=new tANN;
-#endif
+	fitness=0.0;
+	brain.clear();
+	info->genome.clear();
+	info->gates.clear();
+	info->ID=ID;
+	info->born=0;
+	info->nrOfOffspring=0;
+	info->phylogenyNode=-1;
+	info->saved=false;
+	info->retired=false;
+	info->delta.clear();
+	info->nodeMapGenes.clear();
 }
 
 tAgent::~tAgent()
 {
-	for (int i = 0; i < hmmus.size(); ++i)
-    {
-        delete hmmus[i];
-    }
-    
-	if (ancestor!=NULL)
-    {
-		ancestor->nrPointingAtMe--;
-		if (ancestor->nrPointingAtMe == 0)
-        {
-			delete ancestor;
-        }
-	}
-#ifdef useANN
-	delete ANN;
-#endif
+	delete info->gateParser;
+	delete info;
+}
+
+// what a checkpoint needs to bring the agent back; the phenotype is rebuilt
+// from the genome and the random stream is set anew every generation
+void tAgent::saveState(tCheckpoint &checkpoint)
+{
+	checkpoint.putByteVector(info->genome.bytes());
+	checkpoint.putInt(info->ID);
+	checkpoint.putInt(info->born);
+	checkpoint.putInt(info->nrOfOffspring);
+	checkpoint.putInt(info->phylogenyNode);
+}
+
+void tAgent::loadState(tCheckpoint &checkpoint)
+{
+	checkpoint.getByteVector(info->genome.edit());
+	info->ID=checkpoint.getInt();
+	info->born=checkpoint.getInt();
+	info->nrOfOffspring=checkpoint.getInt();
+	info->phylogenyNode=checkpoint.getInt();
+	invalidatePhenotype();
+}
+
+int tAgent::nextID(void)
+{
+	return masterID;
+}
+
+void tAgent::setNextID(int ID)
+{
+	masterID=ID;
 }
 
 void tAgent::setupRandomAgent(int nucleotides)
 {
 	int i;
-	genome.resize(nucleotides);
+	vector<unsigned char> &bytes=info->genome.edit();
+	bytes.resize(nucleotides);
 	for(i=0;i<nucleotides;i++)
-		genome[i]=127;//rand()&255;
+		bytes[i]=127;//rand()&255;
 	ampUpStartCodons();
 //	setupPhenotype();
-#ifdef useANN
-	ANN->setup();
-#endif
 }
 
 void tAgent::setupNodeMap(void)
 {
     for(int i = 0; i < 256; ++i)
     {
-        nodeMap[i] = 0;
+        info->nodeMap[i] = 0;
     }
 }
 
 void tAgent::loadAgent(char* filename)
 {
-	FILE *f=fopen(filename,"r");
-	int i;
-	genome.clear();
-	while(!(feof(f)))
-    {
-		fscanf(f,"%i	",&i);
-		genome.push_back((unsigned char)(i&255));
-	}
-    fclose(f);
+	// binary and tab separated genome files are both accepted
+	tGenomeFile::load(filename,info->genome.edit());
+	invalidatePhenotype();
 	//setupPhenotype();
 }
 
 void tAgent::loadAgentWithTrailer(char* filename)
 {
-#ifdef useANN
-	ANN=new tANN;
-	ANN->load(filename);
-#else
 	FILE *f=fopen(filename,"r+t");
 	int i;
-	genome.clear();
+	vector<unsigned char> &bytes=info->genome.edit();
+	bytes.clear();
 	fscanf(f,"%i	",&i);
-	while(!(feof(f))){
-		fscanf(f,"%i	",&i);
-		genome.push_back((unsigned char)(i&255));
+	while(fscanf(f,"%i",&i)==1){
+		bytes.push_back((unsigned char)(i&255));
 	}
+	fclose(f);
+	invalidatePhenotype();
 	//setupPhenotype();
-#endif
 }
 
 
 void tAgent::ampUpStartCodons(void)
 {
 	int i,j;
+	vector<unsigned char> &bytes=info->genome.edit();
     
     // randomize genome
-	for(i = 0; i < genome.size(); ++i)
+	for(i = 0; i < bytes.size(); ++i)
     {
-		genome[i] = rand() & 255;
+		bytes[i] = (unsigned char)rng.nextBits(8);
     }
     
     // add start gates
 	for(i = 0; i < 4; ++i)
 	{
-		j=rand()%((int)genome.size()-100);
-		genome[j]=42;
-		genome[j+1]=(255-42);
+		j=(int)rng.nextInt((unsigned int)bytes.size()-100);
+		bytes[j]=42;
+		bytes[j+1]=(255-42);
 		for(int k=2;k<20;k++)
-			genome[j+k]=rand()&255;
+			bytes[j+k]=(unsigned char)rng.nextBits(8);
 	}
     
     // add start state map modifiers
     for (i = 0; i < numInputs + numOutputs + 2; ++i)
     {
-        j=rand()%((int)genome.size()-10);
-        genome[j]=41;
-        genome[j+1]=255-41;
-        genome[j+2]=(int)(((double)i / (double)(numInputs + numOutputs + 2)) * maxNodes);
-        genome[j+3]=(int)(double)maxNodes / (double)(numInputs + numOutputs + 2);
-        genome[j+4]=i;
+        j=(int)rng.nextInt((unsigned int)bytes.size()-10);
+        bytes[j]=41;
+        bytes[j+1]=255-41;
+        bytes[j+2]=(int)(((double)i / (double)(numInputs + numOutputs + 2)) * maxNodes);
+        bytes[j+3]=(int)(double)maxNodes / (double)(numInputs + numOutputs + 2);
+        bytes[j+4]=i;
     }
+    
+    invalidatePhenotype();
 }
 
 void tAgent::inherit(tAgent *from, double mutationRate, double duplicationRate, double deletionRate, int theTime)
 {
-	int nucleotides=(int)from->genome.size();
+	int nucleotides=(int)from->info->genome.size();
 	int i,s,o,w;
-	//double localMutationRate=4.0/from->genome.size();
-	vector<unsigned char> buffer;
-	born=theTime;
-	//ancestor=from;
-	//from->nrPointingAtMe++;
-	from->nrOfOffspring++;
-	genome.clear();
-	genome.resize(from->genome.size());
-	for(i=0;i<nucleotides;i++)
+	//double localMutationRate=4.0/from->info->genome.size();
+	info->born=theTime;
+	// siblings are built on different threads
+	__sync_fetch_and_add(&from->info->nrOfOffspring,1);
+	info->delta.clear();
+	// the offspring starts out sharing the parent's bytes; the edits below only
+	// change its piece list, the bytes are copied once when they are first read
+	info->genome.share(from->info->genome);
+	
+	// each site mutates with probability mutationRate. instead of one draw per
+	// site, the gap to the next mutated site is drawn from the matching
+	// geometric distribution, so the cost grows with the number of mutations
+	const double logKeep=(mutationRate<1.0)?log(1.0-mutationRate):-HUGE_VAL;
+	for(i=(int)rng.nextGeometric(logKeep,nucleotides);i<nucleotides;i+=1+(int)rng.nextGeometric(logKeep,nucleotides))
     {
-		if(((double)rand()/(double)RAND_MAX)<mutationRate)
-        {
-			genome[i]=rand()&255;
-        }
-		else
-        {
-			genome[i]=from->genome[i];
-        }
+		unsigned char value=(unsigned char)rng.nextBits(8);
+		info->genome.set(i,value);
+		info->delta.pointPositions.push_back(i);
+		info->delta.pointValues.push_back(value);
     }
     
-    if((((double)rand()/(double)RAND_MAX)<duplicationRate)&&(genome.size()<20000))
+    if((rng.nextDouble()<duplicationRate)&&(info->genome.size()<20000))
     {
         //duplication
-        w=15+rand()&511;
-        s=rand()%((int)genome.size()-w);
-        o=rand()%(int)genome.size();
-        buffer.clear();
-        buffer.insert(buffer.begin(),genome.begin()+s,genome.begin()+s+w);
-        genome.insert(genome.begin()+o,buffer.begin(),buffer.end());
+        w=(15+(int)rng.nextBits(31))&511;
+        s=(int)rng.nextInt((unsigned int)info->genome.size()-w);
+        o=(int)rng.nextInt((unsigned int)info->genome.size());
+        info->genome.duplicate(s,w,o);
+        info->delta.duplicationStart=s;
+        info->delta.duplicationWidth=w;
+        info->delta.duplicationOffset=o;
     }
-    if((((double)rand()/(double)RAND_MAX)<deletionRate)&&(genome.size()>1000))
+    if((rng.nextDouble()<deletionRate)&&(info->genome.size()>1000))
     {
         //deletion
-        w=15+rand()&511;
-        s=rand()%((int)genome.size()-w);
-        genome.erase(genome.begin()+s,genome.begin()+s+w);
+        w=(15+(int)rng.nextBits(31))&511;
+        s=(int)rng.nextInt((unsigned int)info->genome.size()-w);
+        info->genome.erase(s,w);
+        info->delta.deletionStart=s;
+        info->delta.deletionWidth=w;
     }
 
+	// most offspring differ from their parent in a handful of bytes, so only
+	// the genes around the edits are parsed again
+	if(from->phenotypeValid)
+    {
+		setupPhenotypeFrom(from);
+    }
+	else
+    {
+		setupPhenotype();
+    }
+	fitness=0.0;
+}
+
+// takes on the genome of a migrant from another island. the whole genome is
+// its delta, since there is no parent here to derive it from.
+void tAgent::immigrate(const vector<unsigned char> &migrant,int theTime)
+{
+	info->born=theTime;
+	info->delta.clear();
+	info->delta.replacement=migrant;
+	editGenome()=migrant;
 	setupPhenotype();
 	fitness=0.0;
-#ifdef useANN
-	ANN->inherit(ancestor->ANN,mutationRate);
-#endif
 }
 
 void tAgent::setupPhenotype(void)
 {
-	int i,j;
-	tHMMU *hmmu;
+	int i;
     this->setupNodeMap();
-	if(hmmus.size()!=0)
+	info->gates.clear();
+	phenotypeValid=true;
+	tCodonScanner::scan(info->genome.bytes(),info->gateCodons,info->nodeMapGenes);
+	
+    //regular deterministic gates
+	for(i=0;i<info->gateCodons.size();++i)
     {
-		for(i=0;i<hmmus.size();i++)
-        {
-			delete hmmus[i];
-        }
+		getGateParser().setupQuick(info->genome.bytes(),info->gateCodons[i]);
+		//getGateParser().setup(info->genome.bytes(),gateCodons[i]);
+		info->gates.addGate(*info->gateParser,info->gateCodons[i]);
+	}
+    /*
+    //regular probablistic gate
+	if((genome[i]==43)&&(genome[(i+1)%genome.size()]==(255-43))){
+		//hmmu.setup(genome,i);
+		hmmu.setupQuick(genome,i);
+		brain.addGate(hmmu,i);
+	}
+     */
+    //node map modifier genes
+	for(i=0;i<info->nodeMapGenes.size();++i)
+    {
+        applyNodeMapGene(info->nodeMapGenes[i]);
+	}
+    
+    // the node map is only complete after the whole genome was read
+    info->gates.resolve(&info->nodeMap[0]);
+    brain.compile(info->gates);
+}
+
+void tAgent::applyNodeMapGene(int start)
+{
+    int baseIndex = info->genome[(start + 2) % info->genome.size()];
+    int lengthModifier = info->genome[(start + 3) % info->genome.size()];
+    int addVal = info->genome[(start + 4) % info->genome.size()];
+    
+    for(int j = 0; j < lengthModifier; ++j)
+    {
+        int index = (baseIndex + j) % maxNodes;
+        info->nodeMap[index] = (info->nodeMap[index] + addVal) % maxNodes;
     }
-	hmmus.clear();
-	for(i=0;i<genome.size();++i)
+}
+
+// builds the same phenotype as setupPhenotype() for a genome that was made from
+// the parent's genome by the edits in delta. genes no edit touched are copied
+// from the parent; only codons the edits may have created or changed are parsed.
+void tAgent::setupPhenotypeFrom(tAgent *parent)
+{
+	const int parentSize=(int)parent->info->genome.size();
+	const int size=(int)info->genome.size();
+	vector<int> &candidates=info->candidateCodons;
+	vector<int> &gateStarts=info->gateCodons;
+	vector<int> &modifierStarts=info->modifierCodons;
+	int i,g,p,c;
+	
+	candidates.clear();
+	gateStarts.clear();
+	modifierStarts.clear();
+	
+	// codons whose two bytes are not an untouched pair of the parent genome
+	for(i=0;i<(int)info->delta.pointPositions.size();i++)
     {
-        //regular deterministic gate
-		if((genome[i]==42)&&(genome[(i+1)%genome.size()]==(255-42)))
+		c=info->delta.mapPosition(info->delta.pointPositions[i]);
+		if(c>=0)
         {
-			hmmu=new tHMMU;
-			hmmu->setupQuick(genome,i);
-			//hmmu->setup(genome,i);
-			hmmus.push_back(hmmu);
+			candidates.push_back((c+size-1)%size);
+			candidates.push_back(c);
 		}
-        /*
-        //regular probablistic gate
-		if((genome[i]==43)&&(genome[(i+1)%genome.size()]==(255-43))){
-			hmmu=new tHMMU;
-			//hmmu->setup(genome,i);
-			hmmu->setupQuick(genome,i);
-			hmmus.push_back(hmmu);
-		}
-         */
-        //node map modifier gene
-        if((genome[i] == 41) && (genome[(i + 1) % genome.size()] == (255 - 41)))
+	}
+	if(info->delta.duplicationWidth>0)
+    {
+		for(p=info->delta.duplicationOffset-1;p<info->delta.duplicationOffset+info->delta.duplicationWidth;p++)
         {
-            int baseIndex = genome[(i + 2) % genome.size()];
-            int lengthModifier = genome[(i + 3) % genome.size()];
-            int addVal = genome[(i + 4) % genome.size()];
-            
-            for(j = 0; j < lengthModifier; ++j)
+			c=p;
+			if((info->delta.deletionWidth>0)&&(c>=info->delta.deletionStart))
             {
-                int index = (baseIndex + j) % maxNodes;
-                nodeMap[index] = (nodeMap[index] + addVal) % maxNodes;
-            }
-        }
+				if(c<info->delta.deletionStart+info->delta.deletionWidth)
+					continue;
+				c-=info->delta.deletionWidth;
+			}
+			if(c>=0)
+				candidates.push_back(c);
+		}
+	}
+	if((info->delta.deletionWidth>0)&&(info->delta.deletionStart>0))
+		candidates.push_back(info->delta.deletionStart-1);
+	if(size!=parentSize)
+		candidates.push_back(size-1);
+	
+	// the parent's genes either move along with the edits or are parsed again
+	for(g=0;g<(int)parent->info->gates.geneStart.size();g++)
+    {
+		c=info->delta.mapGene(parent->info->gates.geneStart[g],parent->info->gates.geneLength[g],parentSize,size);
+		gateStarts.push_back(c);
+		if((c<0)&&((c=info->delta.mapPosition(parent->info->gates.geneStart[g]))>=0))
+			candidates.push_back(c);
+	}
+	for(i=0;i<(int)parent->info->nodeMapGenes.size();i++)
+    {
+		c=info->delta.mapGene(parent->info->nodeMapGenes[i],5,parentSize,size);
+		if(c>=0)
+			modifierStarts.push_back(c);
+		else if((c=info->delta.mapPosition(parent->info->nodeMapGenes[i]))>=0)
+			candidates.push_back(c);
+	}
+	
+	sort(candidates.begin(),candidates.end());
+	candidates.erase(unique(candidates.begin(),candidates.end()),candidates.end());
+	
+	// surviving and reparsed genes are merged in genome order, the order setupPhenotype() adds them in
+	info->gates.clear();
+	info->nodeMapGenes.clear();
+	g=0;
+	p=0;
+	for(i=0;i<(int)candidates.size();i++)
+    {
+		c=candidates[i];
+		bool survived=false;
+		while((g<(int)gateStarts.size())&&(gateStarts[g]<=c))
+        {
+			if(gateStarts[g]>=0)
+				info->gates.copyGate(parent->info->gates,g,gateStarts[g]);
+			if(gateStarts[g]==c)
+				survived=true;
+			g++;
+		}
+		while((p<(int)modifierStarts.size())&&(modifierStarts[p]<=c))
+        {
+			if(modifierStarts[p]==c)
+				survived=true;
+			info->nodeMapGenes.push_back(modifierStarts[p++]);
+		}
+		if(survived)
+			continue;
+		if((info->genome[c]==42)&&(info->genome[(c+1)%size]==(255-42)))
+        {
+			getGateParser().setupQuick(info->genome.bytes(),c);
+			info->gates.addGate(*info->gateParser,c);
+		}
+		if((info->genome[c]==41)&&(info->genome[(c+1)%size]==(255-41)))
+			info->nodeMapGenes.push_back(c);
 	}
+	for(;g<(int)gateStarts.size();g++)
+    {
+		if(gateStarts[g]>=0)
+			info->gates.copyGate(parent->info->gates,g,gateStarts[g]);
+	}
+	info->nodeMapGenes.insert(info->nodeMapGenes.end(),modifierStarts.begin()+p,modifierStarts.end());
+	
+    this->setupNodeMap();
+	for(i=0;i<(int)info->nodeMapGenes.size();i++)
+		applyNodeMapGene(info->nodeMapGenes[i]);
+	
+	info->gates.resolve(&info->nodeMap[0]);
+	brain.compile(info->gates);
+	phenotypeValid=true;
 }
 
+// builds the phenotype unless the one built last still matches the genome
+void tAgent::ensurePhenotype(void)
+{
+	if(!phenotypeValid)
+    {
+		setupPhenotype();
+    }
+}
+
+// the genome changed, so the phenotype must be rebuilt before it is used
+void tAgent::invalidatePhenotype(void)
+{
+	phenotypeValid=false;
+}
+
+// the genome for writing; code outside tAgent must only change it through
+// this, so that the next ensurePhenotype() rebuilds
+vector<unsigned char> &tAgent::editGenome(void)
+{
+	invalidatePhenotype();
+	return info->genome.edit();
+}
+
+// builds howMany copies of every gate. the copies share one maxNodes-wide
+// state, since the compiled brain addresses nodes with a single byte.
 void tAgent::setupMegaPhenotype(int howMany)
 {
 	int i,j,k;
+	vector<int> &gates=info->gateCodons,&modifiers=info->modifierCodons;
     this->setupNodeMap();
 
-	tHMMU *hmmu;
     
-	if(hmmus.size() > 0)
+	// not the regular phenotype, so the next ensurePhenotype() rebuilds that
+	info->gates.clear();
+	phenotypeValid=false;
+	tCodonScanner::scan(info->genome.bytes(),gates,modifiers);
+	for(i=0;i<modifiers.size();i++)
     {
-		for(vector<tHMMU*>::iterator it = hmmus.begin(), end = hmmus.end(); it != end; ++it)
-        {
-			delete *it;
+        for(k=0;k<(info->genome[(modifiers[i]+3)%info->genome.size()]&maxNodes);k++){
+            info->nodeMap[((info->genome[(modifiers[i]+2)%info->genome.size()]&maxNodes)+k)&maxNodes]++;
         }
     }
-	hmmus.clear();
-	for(i=0;i<genome.size();i++)
+	for(i=0;i<gates.size();i++)
     {
-        if((genome[i]==41)&&(genome[(i+1)%genome.size()]==(255-41))){
-            for(k=0;k<(genome[(i+3)%genome.size()]&maxNodes);k++){
-                nodeMap[((genome[(i+2)%genome.size()]&maxNodes)+k)&maxNodes]++;
-            }
-        }
-		if((genome[i]==42)&&(genome[(i+1)%genome.size()]==(255-42)))
+        getGateParser().setup(info->genome.bytes(), gates[i]);
+        //getGateParser().setupQuick(info->genome.bytes(),gates[i]);
+        for(j=0;j<howMany;j++)
         {
-            for(j=0;j<howMany;j++)
-            {
-                hmmu=new tHMMU;
-                hmmu->setup(genome, i);
-                //hmmu->setupQuick(genome,i);
-                for(int k=0;k<4;k++){
-                    hmmu->ins[k]+=(j*maxNodes);
-                    hmmu->outs[k]+=(j*maxNodes);
-                }
-                hmmus.push_back(hmmu);
-            }
+            info->gates.addGate(*info->gateParser,gates[i]);
         }
+	}
         /*
          if((genome[i]==43)&&(genome[(i+1)%genome.size()]==(255-43))){
-         hmmu=new tHMMU;
-         //hmmu->setup(genome,i);
-         hmmu->setupQuick(genome,i);
-         hmmus.push_back(hmmu);
+         hmmu.setupQuick(genome,i);
+         brain.addGate(hmmu,i);
          }
          */
-	}
     
+    info->gates.resolve(&info->nodeMap[0]);
+    brain.compile(info->gates);
 }
 
 
 void tAgent::retire(void)
 {
-	retired=true;
+	info->retired=true;
+}
+
+tHMMU &tAgent::getGateParser(void)
+{
+	if(info->gateParser==NULL)
+    {
+		info->gateParser=new tHMMU;
+    }
+	return *info->gateParser;
 }
 
-unsigned char * tAgent::getStatesPointer(void)
+uint64_t * tAgent::getStatesPointer(void)
 {
-	return states;
+	return stateBuffers[currentStates];
 }
 
 void tAgent::resetBrain(void)
 {
-	for(int i=0;i<maxNodes;i++)
+	for(int i=0;i<stateWords;i++)
     {
-		states[i]=0;
+		stateBuffers[currentStates][i]=0;
     }
-#ifdef useANN
-	ANN->resetBrain();
-#endif
 }
 
-void tAgent::updateStates(void)
+void tAgent::saveBrainState(tBrainState &snapshot)
 {
-	for(vector<tHMMU*>::iterator it = hmmus.begin(), end = hmmus.end(); it != end; ++it)
+	for(int i=0;i<stateWords;i++)
     {
-		(*it)->update(&states[0],&newStates[0],&nodeMap[0]);
+		snapshot.states[i]=stateBuffers[currentStates][i];
     }
-    
-	for(int i=0;i<maxNodes;i++)
-    {
-		states[i]=newStates[i];
-		newStates[i]=0;
-	}
-	++totalSteps;
 }
 
-void tAgent::showBrain(void)
+void tAgent::restoreBrainState(const tBrainState &snapshot)
 {
-	for(int i=0;i<maxNodes;i++)
+	for(int i=0;i<stateWords;i++)
     {
-		cout<<(int)states[i];
+		stateBuffers[currentStates][i]=snapshot.states[i];
     }
-	cout<<endl;
 }
 
-void tAgent::initialize(int x, int y, int d)
+void tAgent::updateStates(void)
 {
-	//int i,j;
-	//unsigned char dummy;
-	xPos=x;
-	yPos=y;
-	direction=d;
-	steps=0;
-	/*
-	if((rand()&1)==0){
-		scramble[1]=2;
-		scramble[2]=1;
+	uint64_t *states=stateBuffers[currentStates];
+	
+	brain.update(states,stateBuffers[currentStates^1],&rng);
+	
+	// the new states become current; the old buffer is cleared for the next update
+	currentStates^=1;
+	for(int i=0;i<stateWords;i++)
+    {
+		states[i]=0;
 	}
-	*/
+	++totalSteps;
 }
 
-tAgent* tAgent::findLMRCA(void)
+void tAgent::showBrain(void)
 {
-	tAgent *r,*d;
-	if(ancestor==NULL)
-		return NULL;
-	else{
-		r=ancestor;
-		d=NULL;
-		while(r->ancestor!=NULL){
-			if(r->ancestor->nrPointingAtMe!=1)
-				d=r;
-			r=r->ancestor;
-		}
-		return d;
-	}
-}
-
-void tAgent::saveFromLMRCAtoNULL(FILE *statsFile,FILE *genomeFile){
-	if(ancestor!=NULL)
-		ancestor->saveFromLMRCAtoNULL(statsFile,genomeFile);
-	if(!saved){ 
-		fprintf(statsFile,"%i	%i	%i	%f	%i	%f	%i	%i\n",ID,born,(int)genome.size(),fitness,bestSteps,(float)totalSteps/(float)nrOfOffspring,correct,incorrect);
-		fprintf(genomeFile,"%i	",ID);
-		for(int i=0;i<genome.size();i++)
-			fprintf(genomeFile,"	%i",genome[i]);
-		fprintf(genomeFile,"\n");
-		saved=true;
-	}
-	if((saved)&&(retired)) genome.clear();
+	for(int i=0;i<maxNodes;i++)
+    {
+		cout<<getState(i);
+    }
+	cout<<endl;
 }
 
 /*
@@ -411,8 +568,7 @@ void tAgent::saveLOD(FILE *statsFile,FILE *genomeFile){
 
 void tAgent::showPhenotype(void)
 {
-	for(int i=0;i<hmmus.size();i++)
-		hmmus[i]->show(&nodeMap[0]);
+	info->gates.show();
 	cout<<"------"<<endl;
 }
 
@@ -431,16 +587,16 @@ void tAgent::saveToDot(const char *filename)
         print_node[i] = false;
     }
     
-    for(i=0;i<hmmus.size();i++)
+    for(i=0;i<info->gates.size();i++)
     {
-        for(j=0;j<hmmus[i]->ins.size();j++)
+        for(j=0;j<info->gates.nrIns[i];j++)
         {
-            print_node[hmmus[i]->ins[j]] = true;
+            print_node[info->gates.rawIns[info->gates.inStart[i]+j]] = true;
         }
         
-        for(k=0;k<hmmus[i]->outs.size();k++)
+        for(k=0;k<info->gates.nrOuts[i];k++)
         {
-            print_node[hmmus[i]->outs[k]] = true;
+            print_node[info->gates.rawOuts[info->gates.outStart[i]+k]] = true;
         }
     }
     
@@ -479,13 +635,13 @@ void tAgent::saveToDot(const char *filename)
     }
     
     // connections
-	for(i=0;i<hmmus.size();i++)
+	for(i=0;i<info->gates.size();i++)
     {
-		for(j=0;j<hmmus[i]->ins.size();j++)
+		for(j=0;j<info->gates.nrIns[i];j++)
         {
-			for(k=0;k<hmmus[i]->outs.size();k++)
+			for(k=0;k<info->gates.nrOuts[i];k++)
             {
-				fprintf(f,"	%i	->	%i;\n",hmmus[i]->ins[j],hmmus[i]->outs[k]);
+				fprintf(f,"	%i	->	%i;\n",info->gates.rawIns[info->gates.inStart[i]+j],info->gates.rawOuts[info->gates.outStart[i]+k]);
             }
 		}
 	}
@@ -537,37 +693,17 @@ void tAgent::saveToDotFullLayout(char *filename){
 	int i,j,k;
 	fprintf(f,"digraph brain {\n");
 	fprintf(f,"	ranksep=2.0;\n");
-	for(i=0;i<hmmus.size();i++){
+	for(i=0;i<info->gates.size();i++){
 		fprintf(f,"MM_%i [shape=box]\n",i);
-		for(j=0;j<hmmus[i]->ins.size();j++)
-			fprintf(f,"	t0_%i -> MM_%i\n",hmmus[i]->ins[j],i);
-		for(k=0;k<hmmus[i]->outs.size();k++)
-			fprintf(f,"	MM_%i -> t1_%i\n",i,hmmus[i]->outs[k]);
+		for(j=0;j<info->gates.nrIns[i];j++)
+			fprintf(f,"	t0_%i -> MM_%i\n",info->gates.rawIns[info->gates.inStart[i]+j],i);
+		for(k=0;k<info->gates.nrOuts[i];k++)
+			fprintf(f,"	MM_%i -> t1_%i\n",i,info->gates.rawOuts[info->gates.outStart[i]+k]);
 		
 	}
 	fprintf(f,"}\n");
 }
 
-void tAgent::setupDots(int x, int y,double spacing){
-	double xo,yo;
-	int i,j,k;
-	xo=(double)(x-1)*spacing;
-	xo=-(xo/2.0);
-	yo=(double)(y-1)*spacing;
-	yo=-(yo/2.0);
-	dots.resize(x*y);
-	k=0;
-	for(i=0;i<x;i++)
-		for(j=0;j<y;j++){
-//			dots[k].xPos=(double)(rand()%(int)(spacing*x))+xo;
-//			dots[k].yPos=(double)(rand()%(int)(spacing*y))+yo;
-			dots[k].xPos=xo+((double)i*spacing);
-			dots[k].yPos=yo+((double)j*spacing);
-//			cout<<dots[k].xPos<<" "<<dots[k].yPos<<endl;
-			k++;
-		}
-}
-
 void tAgent::saveLogicTable(const char *filename)
 {
     FILE *f=fopen(filename, "w");
@@ -592,7 +728,7 @@ void tAgent::saveLogicTable(const char *filename)
                         fprintf(f,"%i,",(i >> j) & 1);
                     }
                     
-                    states[j] = (i >> j) & 1;
+                    setState(j, (i >> j) & 1);
                 }
                 else if (j == 15)
                 {
@@ -601,11 +737,11 @@ void tAgent::saveLogicTable(const char *filename)
                         fprintf(f,"%i,",(i >> 12) & 1);
                     }
                     
-                    states[j] = (i >> 12) & 1;
+                    setState(j, (i >> 12) & 1);
                 }
                 else
                 {
-                    states[j] = 0;
+                    setState(j, 0);
                 }
             }
             
@@ -613,8 +749,8 @@ void tAgent::saveLogicTable(const char *filename)
             
             vector<int> output;
             // order: 30 31
-            output.push_back(states[30]);
-            output.push_back(states[31]);
+            output.push_back(getState(30));
+            output.push_back(getState(31));
             
             if (outputCounts.count(output) > 0)
             {
@@ -650,14 +786,7 @@ void tAgent::saveLogicTable(const char *filename)
 // saves the Markov network brain genome to a text file
 void tAgent::saveGenome(const char *filename)
 {
-    FILE *f = fopen(filename, "w");
-    
-	for (int i = 0, end = (int)genome.size(); i < end; ++i)
-    {
-		fprintf(f, "%i	", genome[i]);
-    }
-    
-	fprintf(f, "\n");
-    
-    fclose(f);
+	const vector<unsigned char> &bytes=info->genome.bytes();
+	
+	tGenomeFile::saveText(filename, bytes.empty() ? NULL : &bytes[0], bytes.size());
 }
@@ -24,71 +24,99 @@
 
 #include "globalConst.h"
 #include "tHMM.h"
+#include "tBrain.h"
+#include "tRandom.h"
+#include "tGenome.h"
+#include "tGenomeDelta.h"
 #include <vector>
 
 using namespace std;
 
-static int masterID = 0;
-
-class tDot{
+// copy of the brain state, used to branch off several games from a shared history
+class tBrainState{
 public:
-	double xPos,yPos;
+	uint64_t states[stateWords];
 };
 
-
-class tAgent{
+// everything about an agent the game does not touch: the genome, the gates
+// parsed from it, bookkeeping for the phylogeny and the scratch space of the
+// phenotype setup. kept out of tAgent so that the records the evaluation walks
+// through stay small.
+class tAgentInfo{
 public:
-	vector<tHMMU*> hmmus;
-	vector<unsigned char> genome;
-	vector<tDot> dots;
-    unsigned char nodeMap[256];
-#ifdef useANN
-	tANN *ANN;
-#endif
-	
-	tAgent *ancestor;
-	unsigned int nrPointingAtMe;
-	unsigned char states[maxNodes],newStates[maxNodes];
-	double fitness,convFitness;
-	vector<double> fitnesses;
-	int food;
-	
-	double xPos,yPos,direction;
-	double sX,sY;
-	bool foodAlreadyFound;
-	int steps,bestSteps,totalSteps;
-	int ID,nrOfOffspring;
+	int ID,born,nrOfOffspring;
+	int phylogenyNode;
 	bool saved;
 	bool retired;
-	int born;
-	int correct,incorrect;
+	tGenome genome;
+	// the edits that made the genome from the parent's
+	tGenomeDelta delta;
+	tGateList gates;
+	unsigned char nodeMap[256];
+	vector<int> nodeMapGenes;
+	tHMMU *gateParser;
+	vector<int> gateCodons,modifierCodons,candidateCodons;
+};
+
+class tAgent{
+public:
+	// hot part: what the game reads and writes while it plays
+	uint64_t stateBuffers[2][stateWords];
+	int currentStates;
+	tRandom rng;
+	double fitness;
+	int totalSteps;
+	bool phenotypeValid;
+	tBrain brain;
+	tAgentInfo *info;
 	
 	tAgent();
 	~tAgent();
+	void resetAgent(void);
+	void resetAgent(int ID);
+	void saveState(tCheckpoint &checkpoint);
+	void loadState(tCheckpoint &checkpoint);
+	static int nextID(void);
+	static void setNextID(int ID);
 	void setupRandomAgent(int nucleotides);
-    virtual void setupNodeMap(void);
+    void setupNodeMap(void);
 	void loadAgent(char* filename);
 	void loadAgentWithTrailer(char* filename);
 	void setupPhenotype(void);
+	void setupPhenotypeFrom(tAgent *parent);
+	void applyNodeMapGene(int start);
+	void ensurePhenotype(void);
+	vector<unsigned char> &editGenome(void);
     void setupMegaPhenotype(int howMany);
 	void inherit(tAgent *from,double mutationRate,double duplicationRate,double deletionRate,int theTime);
-	unsigned char * getStatesPointer(void);
+	void immigrate(const vector<unsigned char> &migrant,int theTime);
+	uint64_t * getStatesPointer(void);
+	inline int getState(int node){
+		return (int)((stateBuffers[currentStates][node>>6]>>(node&63))&1);
+	}
+	inline void setState(int node,int value){
+		uint64_t mask=(uint64_t)1<<(node&63);
+		uint64_t *word=&stateBuffers[currentStates][node>>6];
+		*word=(*word&~mask)|((uint64_t)(value&1)<<(node&63));
+	}
 	void updateStates(void);
 	void resetBrain(void);
+	void saveBrainState(tBrainState &snapshot);
+	void restoreBrainState(const tBrainState &snapshot);
 	void ampUpStartCodons(void);
 	void showBrain(void);
 	void showPhenotype(void);
 	void saveToDot(const char *filename);
 	void saveToDotFullLayout(char *filename);
 	
-	void initialize(int x, int y, int d);
-	tAgent* findLMRCA(void);
-	void saveFromLMRCAtoNULL(FILE *statsFile,FILE *genomeFile);
 	//void saveLOD(FILE *statsFile,FILE *genomeFile);
 	void retire(void);
-	void setupDots(int x, int y,double spacing);
+	tHMMU &getGateParser(void);
 	void saveLogicTable(const char *filename);
 	void saveGenome(const char *filename);
+	
+private:
+	void invalidatePhenotype(void);
 };
 
 #endif
\ No newline at end of file
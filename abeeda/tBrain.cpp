@@ -0,0 +1,483 @@
+/*
+ * tBrain.cpp
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tBrain.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// empties the list but keeps the allocated buffers for the next parse
+void tGateList::clear(void)
+{
+	nrIns.clear();
+	nrOuts.clear();
+	inStart.clear();
+	outStart.clear();
+	tableStart.clear();
+	rowStart.clear();
+	geneStart.clear();
+	geneLength.clear();
+	rawIns.clear();
+	rawOuts.clear();
+	inNodes.clear();
+	outNodes.clear();
+	tables.clear();
+	sums.clear();
+	deterministic.clear();
+}
+
+int tGateList::size(void)
+{
+	return (int)nrIns.size();
+}
+
+// appends a gate parsed at genome position start; its nodes stay unmapped until resolve() is called
+void tGateList::addGate(tHMMU &gate, int start)
+{
+	int i, j;
+
+	nrIns.push_back((unsigned char)gate.ins.size());
+	nrOuts.push_back((unsigned char)gate.outs.size());
+	inStart.push_back((int)rawIns.size());
+	outStart.push_back((int)rawOuts.size());
+	tableStart.push_back((int)tables.size());
+	rowStart.push_back((int)sums.size());
+	geneStart.push_back(start);
+	// tHMMU::setupQuick reads the table up to 24 + (1 << xDim) * (1 << yDim) bytes past the start codon
+	geneLength.push_back(25 + ((1 << (int)gate.ins.size()) << (int)gate.outs.size()));
+
+	for (i = 0; i < (int)gate.ins.size(); ++i)
+	{
+		rawIns.push_back((unsigned char)gate.ins[i]);
+	}
+
+	for (i = 0; i < (int)gate.outs.size(); ++i)
+	{
+		rawOuts.push_back((unsigned char)gate.outs[i]);
+	}
+
+	bool isDeterministic = true;
+
+	for (i = 0; i < (int)gate.hmm.size(); ++i)
+	{
+		int nonZero = 0;
+
+		for (j = 0; j < (int)gate.hmm[i].size(); ++j)
+		{
+			tables.push_back(gate.hmm[i][j]);
+
+			if (gate.hmm[i][j] != 0)
+			{
+				++nonZero;
+			}
+		}
+
+		sums.push_back(gate.sums[i]);
+
+		// the roulette wheel can only ever stop on the one non-zero entry
+		if (nonZero != 1)
+		{
+			isDeterministic = false;
+		}
+	}
+
+	deterministic.push_back(isDeterministic);
+}
+
+// appends gate g of another list, whose gene now starts at genome position start;
+// its nodes stay unmapped until resolve() is called
+void tGateList::copyGate(tGateList &from, int g, int start)
+{
+	const int nIn = from.nrIns[g], nOut = from.nrOuts[g];
+
+	nrIns.push_back((unsigned char)nIn);
+	nrOuts.push_back((unsigned char)nOut);
+	inStart.push_back((int)rawIns.size());
+	outStart.push_back((int)rawOuts.size());
+	tableStart.push_back((int)tables.size());
+	rowStart.push_back((int)sums.size());
+	geneStart.push_back(start);
+	geneLength.push_back(from.geneLength[g]);
+
+	rawIns.insert(rawIns.end(), from.rawIns.begin() + from.inStart[g], from.rawIns.begin() + from.inStart[g] + nIn);
+	rawOuts.insert(rawOuts.end(), from.rawOuts.begin() + from.outStart[g], from.rawOuts.begin() + from.outStart[g] + nOut);
+	tables.insert(tables.end(), from.tables.begin() + from.tableStart[g], from.tables.begin() + from.tableStart[g] + ((1 << nIn) << nOut));
+	sums.insert(sums.end(), from.sums.begin() + from.rowStart[g], from.sums.begin() + from.rowStart[g] + (1 << nIn));
+	deterministic.push_back(from.deterministic[g]);
+}
+
+// applies the node map once, so that the compiled brain indexes the state arrays directly
+void tGateList::resolve(unsigned char *nodeMap)
+{
+	int i;
+
+	inNodes.resize(rawIns.size());
+	outNodes.resize(rawOuts.size());
+
+	for (i = 0; i < (int)rawIns.size(); ++i)
+	{
+		inNodes[i] = nodeMap[rawIns[i]];
+	}
+
+	for (i = 0; i < (int)rawOuts.size(); ++i)
+	{
+		outNodes[i] = nodeMap[rawOuts[i]];
+	}
+}
+
+void tGateList::show(void)
+{
+	int g, i, j;
+
+	for (g = 0; g < size(); ++g)
+	{
+		cout << "INS: ";
+		for (i = 0; i < nrIns[g]; ++i)
+			cout << (int)inNodes[inStart[g] + i] << " ";
+		cout << endl;
+		cout << "OUTS: ";
+		for (i = 0; i < nrOuts[g]; ++i)
+			cout << (int)outNodes[outStart[g] + i] << " ";
+		cout << endl;
+		for (i = 0; i < (1 << nrIns[g]); ++i)
+		{
+			for (j = 0; j < (1 << nrOuts[g]); ++j)
+				cout << " " << (double)tables[tableStart[g] + (i << nrOuts[g]) + j] / sums[rowStart[g] + i];
+			cout << endl;
+		}
+		cout << endl;
+	}
+}
+
+tBrain::tBrain()
+{
+	memory = NULL;
+	capacity = 0;
+	clear();
+}
+
+tBrain::~tBrain()
+{
+	free(memory);
+}
+
+// forgets the gates but keeps the block for the next compile
+void tBrain::clear(void)
+{
+	nrDeterministic = nrProbabilistic = 0;
+	detNrIns = detNrOuts = detIns = detOuts = detLuts = detTruth = 0;
+	probNrIns = probNrOuts = probIns = probOuts = probTables = probSums = 0;
+}
+
+// lays the resolved gates out for the two kernels. the 32-bit row sums go
+// first and the 16-bit truth tables second so that both stay aligned
+void tBrain::compile(tGateList &gates)
+{
+	int g, nrDetIns = 0, nrDetOuts = 0, nrLuts = 0;
+	int nrProbIns = 0, nrProbOuts = 0, nrTables = 0, nrSums = 0;
+
+	clear();
+
+	for (g = 0; g < gates.size(); ++g)
+	{
+		const int nIn = gates.nrIns[g], nOut = gates.nrOuts[g];
+
+		if (gates.deterministic[g])
+		{
+			++nrDeterministic;
+			nrDetIns += nIn;
+			nrDetOuts += nOut;
+			nrLuts += 1 << nIn;
+		}
+		else
+		{
+			++nrProbabilistic;
+			nrProbIns += nIn;
+			nrProbOuts += nOut;
+			nrTables += (1 << nIn) << nOut;
+			nrSums += 1 << nIn;
+		}
+	}
+
+	probSums = 0;
+	detTruth = probSums + nrSums * (int)sizeof(unsigned int);
+	detNrIns = detTruth + nrDetOuts * (int)sizeof(uint16_t);
+	detNrOuts = detNrIns + nrDeterministic;
+	detIns = detNrOuts + nrDeterministic;
+	detOuts = detIns + nrDetIns;
+	detLuts = detOuts + nrDetOuts;
+	probNrIns = detLuts + nrLuts;
+	probNrOuts = probNrIns + nrProbabilistic;
+	probIns = probNrOuts + nrProbabilistic;
+	probOuts = probIns + nrProbIns;
+	probTables = probOuts + nrProbOuts;
+
+	const int needed = probTables + nrTables;
+
+	if (needed > capacity)
+	{
+		free(memory);
+		memory = (unsigned char*)malloc(needed);
+		capacity = needed;
+	}
+
+	unsigned int *sum = (unsigned int*)(memory + probSums);
+	uint16_t *truth = (uint16_t*)(memory + detTruth);
+	unsigned char *dNrIns = memory + detNrIns, *dNrOuts = memory + detNrOuts;
+	unsigned char *dIns = memory + detIns, *dOuts = memory + detOuts, *lut = memory + detLuts;
+	unsigned char *pNrIns = memory + probNrIns, *pNrOuts = memory + probNrOuts;
+	unsigned char *pIns = memory + probIns, *pOuts = memory + probOuts, *table = memory + probTables;
+
+	for (g = 0; g < gates.size(); ++g)
+	{
+		const int nIn = gates.nrIns[g], nOut = gates.nrOuts[g];
+		const unsigned char *in = &gates.inNodes[gates.inStart[g]];
+		const unsigned char *out = &gates.outNodes[gates.outStart[g]];
+		const unsigned char *rows = &gates.tables[gates.tableStart[g]];
+
+		if (gates.deterministic[g])
+		{
+			*dNrIns++ = (unsigned char)nIn;
+			*dNrOuts++ = (unsigned char)nOut;
+			memcpy(dIns, in, nIn);
+			memcpy(dOuts, out, nOut);
+			dIns += nIn;
+			dOuts += nOut;
+
+			for (int I = 0; I < (1 << nIn); ++I)
+			{
+				int j = 0;
+
+				while (rows[(I << nOut) + j] == 0)
+				{
+					++j;
+				}
+
+				lut[I] = (unsigned char)j;
+			}
+
+			for (int o = 0; o < nOut; ++o)
+			{
+				uint16_t t = 0;
+
+				for (int I = 0; I < (1 << nIn); ++I)
+				{
+					t |= (uint16_t)(((lut[I] >> o) & 1) << I);
+				}
+
+				*truth++ = t;
+			}
+
+			lut += 1 << nIn;
+		}
+		else
+		{
+			*pNrIns++ = (unsigned char)nIn;
+			*pNrOuts++ = (unsigned char)nOut;
+			memcpy(pIns, in, nIn);
+			memcpy(pOuts, out, nOut);
+			memcpy(table, rows, (1 << nIn) << nOut);
+			memcpy(sum, &gates.sums[gates.rowStart[g]], (1 << nIn) * sizeof(unsigned int));
+			pIns += nIn;
+			pOuts += nOut;
+			table += (1 << nIn) << nOut;
+			sum += 1 << nIn;
+		}
+	}
+}
+
+// one time step of all gates: reads states, ORs the gate outputs into newStates
+void tBrain::update(const uint64_t *states, uint64_t *newStates, tRandom *rng)
+{
+	updateDeterministic(states, newStates);
+	updateProbabilistic(states, newStates, rng);
+}
+
+void tBrain::updateDeterministic(const uint64_t *states, uint64_t *newStates)
+{
+	const unsigned char *nrIns = memory + detNrIns, *nrOuts = memory + detNrOuts;
+	const unsigned char *in = memory + detIns;
+	const unsigned char *out = memory + detOuts;
+	const unsigned char *lut = memory + detLuts;
+
+	for (int g = 0; g < nrDeterministic; ++g)
+	{
+		const int nIn = nrIns[g], nOut = nrOuts[g];
+		int I = 0;
+		int i, j;
+
+		for (i = 0; i < nIn; ++i)
+		{
+			I = (I << 1) | (int)((states[in[i] >> 6] >> (in[i] & 63)) & 1);
+		}
+
+		j = lut[I];
+
+		for (i = 0; i < nOut; ++i)
+		{
+			newStates[out[i] >> 6] |= (uint64_t)((j >> i) & 1) << (out[i] & 63);
+		}
+
+		in += nIn;
+		out += nOut;
+		lut += 1 << nIn;
+	}
+}
+
+void tBrain::updateProbabilistic(const uint64_t *states, uint64_t *newStates, tRandom *rng)
+{
+	const unsigned char *nrIns = memory + probNrIns, *nrOuts = memory + probNrOuts;
+	const unsigned char *in = memory + probIns;
+	const unsigned char *out = memory + probOuts;
+	const unsigned char *table = memory + probTables;
+	const unsigned int *sum = (const unsigned int*)(memory + probSums);
+
+	for (int g = 0; g < nrProbabilistic; ++g)
+	{
+		const int nIn = nrIns[g], nOut = nrOuts[g];
+		int I = 0;
+		int i, j, r;
+
+		for (i = 0; i < nIn; ++i)
+		{
+			I = (I << 1) | (int)((states[in[i] >> 6] >> (in[i] & 63)) & 1);
+		}
+
+		const unsigned char *row = table + (I << nOut);
+
+		r = 1 + (int)rng->nextInt(sum[I] - 1);
+		j = 0;
+		while (r > row[j])
+		{
+			r -= row[j];
+			++j;
+		}
+
+		for (i = 0; i < nOut; ++i)
+		{
+			newStates[out[i] >> 6] |= (uint64_t)((j >> i) & 1) << (out[i] & 63);
+		}
+
+		in += nIn;
+		out += nOut;
+		table += (1 << nIn) << nOut;
+		sum += 1 << nIn;
+	}
+}
+
+// one time step of up to 64 brain copies; states and newStates hold one lane word per node
+void tBrain::updateSliced(const uint64_t *states, uint64_t *newStates, int lanes, tRandom *rng)
+{
+	int g, i, k;
+
+	// deterministic gates: build all input minterms, then OR together the ones
+	// each output bit is true for
+	const unsigned char *nrIns = memory + detNrIns, *nrOuts = memory + detNrOuts;
+	const unsigned char *in = memory + detIns;
+	const unsigned char *out = memory + detOuts;
+	const uint16_t *truth = (const uint16_t*)(memory + detTruth);
+
+	for (g = 0; g < nrDeterministic; ++g)
+	{
+		const int nIn = nrIns[g], nOut = nrOuts[g];
+		uint64_t minterm[16];
+		int n = 1;
+
+		minterm[0] = ~(uint64_t)0;
+
+		// the first input is the most significant bit of the pattern
+		for (k = 0; k < nIn; ++k)
+		{
+			const uint64_t x = states[in[k]];
+
+			for (int t = n - 1; t >= 0; --t)
+			{
+				minterm[2 * t + 1] = minterm[t] & x;
+				minterm[2 * t] = minterm[t] & ~x;
+			}
+
+			n <<= 1;
+		}
+
+		for (i = 0; i < nOut; ++i)
+		{
+			uint64_t result = 0;
+
+			for (int I = 0; I < n; ++I)
+			{
+				if ((truth[i] >> I) & 1)
+				{
+					result |= minterm[I];
+				}
+			}
+
+			newStates[out[i]] |= result;
+		}
+
+		in += nIn;
+		out += nOut;
+		truth += nOut;
+	}
+
+	// probabilistic gates need a draw per copy, so they run lane by lane
+	nrIns = memory + probNrIns;
+	nrOuts = memory + probNrOuts;
+	in = memory + probIns;
+	out = memory + probOuts;
+	const unsigned char *table = memory + probTables;
+	const unsigned int *sum = (const unsigned int*)(memory + probSums);
+
+	for (g = 0; g < nrProbabilistic; ++g)
+	{
+		const int nIn = nrIns[g], nOut = nrOuts[g];
+
+		for (int lane = 0; lane < lanes; ++lane)
+		{
+			int I = 0;
+			int j, r;
+
+			for (i = 0; i < nIn; ++i)
+			{
+				I = (I << 1) | (int)((states[in[i]] >> lane) & 1);
+			}
+
+			const unsigned char *row = table + (I << nOut);
+
+			r = 1 + (int)rng->nextInt(sum[I] - 1);
+			j = 0;
+			while (r > row[j])
+			{
+				r -= row[j];
+				++j;
+			}
+
+			for (i = 0; i < nOut; ++i)
+			{
+				newStates[out[i]] |= (uint64_t)((j >> i) & 1) << lane;
+			}
+		}
+
+		in += nIn;
+		out += nOut;
+		table += (1 << nIn) << nOut;
+		sum += 1 << nIn;
+	}
+}
@@ -0,0 +1,100 @@
+/*
+ * tBrain.h
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _tBrain_h_included_
+#define _tBrain_h_included_
+
+#include <vector>
+#include <stdint.h>
+#include "globalConst.h"
+#include "tHMM.h"
+#include "tRandom.h"
+
+using namespace std;
+
+// the gates of an agent as parsed from its genome. gate g reads nrIns[g]
+// nodes starting at inStart[g], writes nrOuts[g] nodes starting at
+// outStart[g] and owns (1 << nrIns[g]) rows of (1 << nrOuts[g]) table entries
+// starting at tableStart[g]. rawIns/rawOuts hold the node numbers as encoded
+// in the genome, inNodes/outNodes the same nodes after the node map was
+// applied. geneStart[g] is the genome position of the gate's start codon and
+// geneLength[g] the number of bytes from there the gate was parsed from.
+//
+// only the phenotype setup needs this; the game runs the tBrain it is
+// compiled into.
+class tGateList{
+public:
+	vector<unsigned char> nrIns, nrOuts;
+	vector<int> inStart, outStart, tableStart, rowStart;
+	vector<int> geneStart, geneLength;
+	vector<unsigned char> rawIns, rawOuts;
+	vector<unsigned char> inNodes, outNodes;
+	vector<unsigned char> tables;
+	vector<unsigned int> sums;
+	vector<bool> deterministic;
+
+	void clear(void);
+	int size(void);
+	void addGate(tHMMU &gate, int start);
+	void copyGate(tGateList &from, int g, int start);
+	void resolve(unsigned char *nodeMap);
+	void show(void);
+};
+
+// the gates compiled into the arrays the update kernels walk, all of them in
+// one block of memory that is kept for the next compile.
+//
+// the brain state is a bit vector of maxNodes bits packed into stateWords
+// 64-bit words; node n is bit (n & 63) of word (n >> 6).
+//
+// updateSliced() runs up to 64 independent copies of the brain at once: there
+// the state is one word per node and bit k of every word belongs to copy k.
+//
+// gates whose table rows each have a single non-zero entry always give the
+// same output and are run as plain lookup tables (det*), all others keep the
+// roulette wheel (prob*). detTruth holds, for every output of every
+// deterministic gate, the truth table of that output bit with input pattern I
+// at bit I. the det* and prob* members are offsets into the block.
+class tBrain{
+public:
+	tBrain();
+	~tBrain();
+	void clear(void);
+	inline int size(void) { return nrDeterministic + nrProbabilistic; }
+	inline bool isDeterministic(void) { return nrProbabilistic == 0; }
+	void compile(tGateList &gates);
+	void update(const uint64_t *states, uint64_t *newStates, tRandom *rng);
+	void updateSliced(const uint64_t *states, uint64_t *newStates, int lanes, tRandom *rng);
+
+private:
+	unsigned char *memory;
+	int capacity;
+	int nrDeterministic, nrProbabilistic;
+	int detNrIns, detNrOuts, detIns, detOuts, detLuts, detTruth;
+	int probNrIns, probNrOuts, probIns, probOuts, probTables, probSums;
+
+	tBrain(const tBrain &other);
+	tBrain &operator=(const tBrain &other);
+	void updateDeterministic(const uint64_t *states, uint64_t *newStates);
+	void updateProbabilistic(const uint64_t *states, uint64_t *newStates, tRandom *rng);
+};
+
+#endif
@@ -0,0 +1,404 @@
+/*
+ * tCheckpoint.cpp
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "tCheckpoint.h"
+#include "tGenomeFile.h"
+
+static const char checkpointMagic[8] = { 'S', 'M', 'N', 'C', 'H', 'K', 'P', 'T' };
+
+// magic, version, header size, length and checksum
+#define checkpointHeaderSize 32
+
+tCheckpoint::tCheckpoint()
+{
+	clear();
+}
+
+void tCheckpoint::clear(void)
+{
+	data.clear();
+	readPosition = 0;
+	failed = false;
+}
+
+void tCheckpoint::putBytes(const void *bytes, size_t length)
+{
+	data.insert(data.end(), (const unsigned char *)bytes, (const unsigned char *)bytes + length);
+}
+
+void tCheckpoint::putInt(int value)
+{
+	putUInt64((uint64_t)(int64_t)value);
+}
+
+void tCheckpoint::putUInt64(uint64_t value)
+{
+	unsigned char bytes[8];
+
+	tGenomeFile::putWord(bytes, value, 8);
+	putBytes(bytes, sizeof(bytes));
+}
+
+// the bits of the IEEE 754 double, in the same byte order as the integers
+void tCheckpoint::putDouble(double value)
+{
+	uint64_t bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+	putUInt64(bits);
+}
+
+void tCheckpoint::putString(const string &value)
+{
+	putInt((int)value.size());
+	putBytes(value.data(), value.size());
+}
+
+void tCheckpoint::putIntVector(const vector<int> &values)
+{
+	unsigned char bytes[4];
+
+	putInt((int)values.size());
+
+	for (size_t i = 0; i < values.size(); ++i)
+	{
+		tGenomeFile::putWord(bytes, (uint32_t)values[i], 4);
+		putBytes(bytes, sizeof(bytes));
+	}
+}
+
+void tCheckpoint::putByteVector(const vector<unsigned char> &values)
+{
+	putInt((int)values.size());
+
+	if (!values.empty())
+	{
+		putBytes(&values[0], values.size());
+	}
+}
+
+void tCheckpoint::getBytes(void *bytes, size_t length)
+{
+	if (failed || length > data.size() - readPosition)
+	{
+		failed = true;
+		memset(bytes, 0, length);
+		return;
+	}
+
+	memcpy(bytes, &data[readPosition], length);
+	readPosition += length;
+}
+
+int tCheckpoint::getInt(void)
+{
+	return (int)(int64_t)getUInt64();
+}
+
+uint64_t tCheckpoint::getUInt64(void)
+{
+	unsigned char bytes[8];
+
+	getBytes(bytes, sizeof(bytes));
+
+	return tGenomeFile::getWord(bytes, 8);
+}
+
+double tCheckpoint::getDouble(void)
+{
+	uint64_t bits = getUInt64();
+	double v;
+
+	memcpy(&v, &bits, sizeof(v));
+
+	return v;
+}
+
+string tCheckpoint::getString(void)
+{
+	int length = getInt();
+
+	if (failed || length < 0 || (size_t)length > data.size() - readPosition)
+	{
+		failed = true;
+		return "";
+	}
+
+	string value((const char *)&data[readPosition], (size_t)length);
+	readPosition += (size_t)length;
+
+	return value;
+}
+
+void tCheckpoint::getIntVector(vector<int> &values)
+{
+	int length = getInt();
+
+	values.clear();
+
+	if (failed || length < 0 || (size_t)length > (data.size() - readPosition) / 4)
+	{
+		failed = true;
+		return;
+	}
+
+	values.resize((size_t)length);
+
+	for (int i = 0; i < length; ++i)
+	{
+		unsigned char bytes[4];
+
+		getBytes(bytes, sizeof(bytes));
+		values[i] = (int)(int32_t)tGenomeFile::getWord(bytes, 4);
+	}
+}
+
+void tCheckpoint::getByteVector(vector<unsigned char> &values)
+{
+	int length = getInt();
+
+	values.clear();
+
+	if (failed || length < 0 || (size_t)length > data.size() - readPosition)
+	{
+		failed = true;
+		return;
+	}
+
+	values.resize((size_t)length);
+
+	if (length > 0)
+	{
+		getBytes(&values[0], values.size());
+	}
+}
+
+// the checkpoint is written to a temporary file, forced to disk and only then
+// renamed over the old one, so a crash at any point leaves either the old or
+// the new checkpoint behind, never a mix of both
+bool tCheckpoint::save(const char *filename) const
+{
+	unsigned char header[checkpointHeaderSize];
+	string temporary = string(filename) + ".tmp";
+	FILE *f = fopen(temporary.c_str(), "wb");
+	bool written;
+
+	if (f == NULL)
+	{
+		return false;
+	}
+
+	memcpy(header, checkpointMagic, sizeof(checkpointMagic));
+	tGenomeFile::putWord(header + 8, checkpointVersion, 4);
+	tGenomeFile::putWord(header + 12, checkpointHeaderSize, 4);
+	tGenomeFile::putWord(header + 16, data.size(), 8);
+	tGenomeFile::putWord(header + 24, tGenomeFile::checksum(data.empty() ? NULL : &data[0], data.size()), 8);
+
+	written = fwrite(header, sizeof(header), 1, f) == 1
+		&& (data.empty() || fwrite(&data[0], data.size(), 1, f) == 1)
+		&& fflush(f) == 0
+		&& fsync(fileno(f)) == 0;
+	written = (fclose(f) == 0) && written;
+
+	if (!written || rename(temporary.c_str(), filename) != 0)
+	{
+		remove(temporary.c_str());
+		return false;
+	}
+
+	// make the rename itself survive a crash
+	string directory = filename;
+	size_t slash = directory.rfind('/');
+
+	directory = (slash == string::npos) ? "." : directory.substr(0, slash + 1);
+
+	int fd = open(directory.c_str(), O_RDONLY);
+
+	if (fd >= 0)
+	{
+		fsync(fd);
+		close(fd);
+	}
+
+	return true;
+}
+
+bool tCheckpoint::load(const char *filename)
+{
+	unsigned char header[checkpointHeaderSize];
+	struct stat st;
+	FILE *f = fopen(filename, "rb");
+
+	clear();
+
+	if (f == NULL)
+	{
+		failed = true;
+		return false;
+	}
+
+	if (fread(header, sizeof(header), 1, f) != 1
+		|| memcmp(header, checkpointMagic, sizeof(checkpointMagic)) != 0
+		|| tGenomeFile::getWord(header + 8, 4) != checkpointVersion
+		|| tGenomeFile::getWord(header + 12, 4) != checkpointHeaderSize
+		|| fstat(fileno(f), &st) != 0
+		|| tGenomeFile::getWord(header + 16, 8) != (uint64_t)st.st_size - checkpointHeaderSize)
+	{
+		fclose(f);
+		failed = true;
+		return false;
+	}
+
+	data.resize((size_t)tGenomeFile::getWord(header + 16, 8));
+
+	if ((!data.empty() && fread(&data[0], data.size(), 1, f) != 1)
+		|| tGenomeFile::checksum(data.empty() ? NULL : &data[0], data.size()) != tGenomeFile::getWord(header + 24, 8))
+	{
+		fclose(f);
+		clear();
+		failed = true;
+		return false;
+	}
+
+	fclose(f);
+
+	return true;
+}
+
+tCheckpointWriter::tCheckpointWriter()
+{
+	filling = 0;
+	writing = -1;
+	allWritten = true;
+	shuttingDown = false;
+
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&changed, NULL);
+	pthread_create(&writer, NULL, &tCheckpointWriter::writerMain, this);
+}
+
+tCheckpointWriter::~tCheckpointWriter()
+{
+	finish();
+
+	pthread_mutex_lock(&lock);
+	shuttingDown = true;
+	pthread_cond_broadcast(&changed);
+	pthread_mutex_unlock(&lock);
+
+	pthread_join(writer, NULL);
+	pthread_mutex_destroy(&lock);
+	pthread_cond_destroy(&changed);
+}
+
+// the checkpoint to fill next, emptied. the writer thread never touches it.
+tCheckpoint &tCheckpointWriter::next(void)
+{
+	checkpoints[filling].clear();
+
+	return checkpoints[filling];
+}
+
+// hands the filled checkpoint to the writer thread; waits only if the one
+// before it is still being written
+void tCheckpointWriter::submit(const string &filename)
+{
+	pthread_mutex_lock(&lock);
+
+	while (writing >= 0)
+	{
+		pthread_cond_wait(&changed, &lock);
+	}
+
+	writing = filling;
+	writingFile = filename;
+	filling ^= 1;
+	pthread_cond_broadcast(&changed);
+	pthread_mutex_unlock(&lock);
+}
+
+// waits for the last submitted checkpoint; false if any write failed
+bool tCheckpointWriter::finish(void)
+{
+	bool ok;
+
+	pthread_mutex_lock(&lock);
+
+	while (writing >= 0)
+	{
+		pthread_cond_wait(&changed, &lock);
+	}
+
+	ok = allWritten;
+	pthread_mutex_unlock(&lock);
+
+	return ok;
+}
+
+void *tCheckpointWriter::writerMain(void *arg)
+{
+	((tCheckpointWriter *)arg)->run();
+
+	return NULL;
+}
+
+void tCheckpointWriter::run(void)
+{
+	pthread_mutex_lock(&lock);
+
+	while (true)
+	{
+		while ((writing < 0) && !shuttingDown)
+		{
+			pthread_cond_wait(&changed, &lock);
+		}
+
+		if (writing < 0)
+		{
+			break;
+		}
+
+		tCheckpoint &checkpoint = checkpoints[writing];
+		string filename = writingFile;
+
+		pthread_mutex_unlock(&lock);
+
+		bool ok = checkpoint.save(filename.c_str());
+
+		pthread_mutex_lock(&lock);
+
+		if (!ok)
+		{
+			fprintf(stderr, "could not write checkpoint %s.\n", filename.c_str());
+			allWritten = false;
+		}
+
+		writing = -1;
+		pthread_cond_broadcast(&changed);
+	}
+
+	pthread_mutex_unlock(&lock);
+}
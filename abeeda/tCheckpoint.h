@@ -0,0 +1,95 @@
+/*
+ * tCheckpoint.h
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _tCheckpoint_h_included_
+#define _tCheckpoint_h_included_
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define checkpointVersion 3
+
+// the state of a run as one flat block of bytes. values are put in and got
+// back out in the same order; a get past the end or a file that does not
+// match the magic, version and checksum sets failed, and everything got
+// after that is zero. numbers are stored most significant byte first, so a
+// checkpoint can be resumed on another machine.
+class tCheckpoint{
+public:
+	vector<unsigned char> data;
+	size_t readPosition;
+	bool failed;
+
+	tCheckpoint();
+	void clear(void);
+
+	void putBytes(const void *bytes, size_t length);
+	void putInt(int value);
+	void putUInt64(uint64_t value);
+	void putDouble(double value);
+	void putString(const string &value);
+	void putIntVector(const vector<int> &values);
+	void putByteVector(const vector<unsigned char> &values);
+
+	void getBytes(void *bytes, size_t length);
+	int getInt(void);
+	uint64_t getUInt64(void);
+	double getDouble(void);
+	string getString(void);
+	void getIntVector(vector<int> &values);
+	void getByteVector(vector<unsigned char> &values);
+
+	bool save(const char *filename) const;
+	bool load(const char *filename);
+};
+
+// writes checkpoints on a thread of its own. the run fills one checkpoint
+// while the other one is on its way to disk, and only waits when it is done
+// with the next one before the previous one has been written.
+class tCheckpointWriter{
+public:
+	tCheckpointWriter();
+	~tCheckpointWriter();
+	tCheckpoint &next(void);
+	void submit(const string &filename);
+	bool finish(void);
+
+private:
+	pthread_t writer;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	tCheckpoint checkpoints[2];
+	int filling;
+	int writing;
+	string writingFile;
+	bool allWritten;
+	bool shuttingDown;
+
+	static void *writerMain(void *arg);
+	void run(void);
+};
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ * tCodonScanner.cpp
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tCodonScanner.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// appends base + the index of every set bit of mask, lowest first
+static inline void addPositions(unsigned int mask, int base, vector<int> &positions)
+{
+	while (mask != 0)
+	{
+		positions.push_back(base + __builtin_ctz(mask));
+		mask &= mask - 1;
+	}
+}
+
+// gates and nodeMapGenes receive the codon positions in ascending order
+void tCodonScanner::scan(const vector<unsigned char> &genome, vector<int> &gates, vector<int> &nodeMapGenes)
+{
+	const int size = (int)genome.size();
+	int i = 0;
+
+	gates.clear();
+	nodeMapGenes.clear();
+
+	if (size == 0)
+	{
+		return;
+	}
+
+	const unsigned char *g = &genome[0];
+
+	// every position i of a block also needs byte i + 1, so blocks stop one byte short of the end
+#if defined(__AVX2__)
+	const __m256i gateFirst = _mm256_set1_epi8((char)42), gateSecond = _mm256_set1_epi8((char)(255 - 42));
+	const __m256i mapFirst = _mm256_set1_epi8((char)41), mapSecond = _mm256_set1_epi8((char)(255 - 41));
+
+	for (; i + 33 <= size; i += 32)
+	{
+		const __m256i a = _mm256_loadu_si256((const __m256i*)(g + i));
+		const __m256i b = _mm256_loadu_si256((const __m256i*)(g + i + 1));
+		const unsigned int gateMask = (unsigned int)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, gateFirst), _mm256_cmpeq_epi8(b, gateSecond)));
+		const unsigned int mapMask = (unsigned int)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, mapFirst), _mm256_cmpeq_epi8(b, mapSecond)));
+
+		addPositions(gateMask, i, gates);
+		addPositions(mapMask, i, nodeMapGenes);
+	}
+#elif defined(__SSE2__)
+	const __m128i gateFirst = _mm_set1_epi8((char)42), gateSecond = _mm_set1_epi8((char)(255 - 42));
+	const __m128i mapFirst = _mm_set1_epi8((char)41), mapSecond = _mm_set1_epi8((char)(255 - 41));
+
+	for (; i + 17 <= size; i += 16)
+	{
+		const __m128i a = _mm_loadu_si128((const __m128i*)(g + i));
+		const __m128i b = _mm_loadu_si128((const __m128i*)(g + i + 1));
+		const unsigned int gateMask = (unsigned int)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, gateFirst), _mm_cmpeq_epi8(b, gateSecond)));
+		const unsigned int mapMask = (unsigned int)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, mapFirst), _mm_cmpeq_epi8(b, mapSecond)));
+
+		addPositions(gateMask, i, gates);
+		addPositions(mapMask, i, nodeMapGenes);
+	}
+#endif
+
+	for (; i < size - 1; ++i)
+	{
+		if ((g[i] == 42) && (g[i + 1] == (255 - 42)))
+		{
+			gates.push_back(i);
+		}
+		else if ((g[i] == 41) && (g[i + 1] == (255 - 41)))
+		{
+			nodeMapGenes.push_back(i);
+		}
+	}
+
+	// the codon that wraps around the end of the genome
+	if ((g[size - 1] == 42) && (g[0] == (255 - 42)))
+	{
+		gates.push_back(size - 1);
+	}
+	else if ((g[size - 1] == 41) && (g[0] == (255 - 41)))
+	{
+		nodeMapGenes.push_back(size - 1);
+	}
+}
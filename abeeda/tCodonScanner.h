@@ -0,0 +1,40 @@
+/*
+ * tCodonScanner.h
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _tCodonScanner_h_included_
+#define _tCodonScanner_h_included_
+
+#include <vector>
+
+using namespace std;
+
+// finds the start codons of a genome: gate genes start with 42, 255-42 and
+// node map modifier genes with 41, 255-41. the genome is circular, so the
+// last byte and the first byte also form a codon.
+//
+// compares 32 (AVX2) or 16 (SSE2) positions at a time where the compiler
+// targets those instruction sets, byte by byte otherwise.
+class tCodonScanner{
+public:
+	static void scan(const vector<unsigned char> &genome, vector<int> &gates, vector<int> &nodeMapGenes);
+};
+
+#endif
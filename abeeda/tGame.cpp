@@ -24,13 +24,15 @@
 #include <float.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <limits.h>
 
 tGame::tGame() { }
 
 tGame::~tGame() { }
 
 // runs the simulation for the given agent
-string tGame::executeGame(tAgent* gameAgent, FILE *data_file, bool report)
+// draws its random numbers from the agent's own stream so that several agents can be evaluated at once
+string tGame::executeGame(tAgent* gameAgent, FILE *data_file, bool)
 {
     // LOD data variables
     double agentFitness = 0.0;
@@ -38,8 +40,8 @@ string tGame::executeGame(tAgent* gameAgent, FILE *data_file, bool report)
     // string containing the information to create a video of the simulation
     string reportString = "";
     
-    // set up brain
-    gameAgent->setupPhenotype();
+    // set up brain; it is only rebuilt if the genome changed since the last game
+    gameAgent->ensurePhenotype();
     gameAgent->fitness = 0.0;
     
     int round = 1;
@@ -61,18 +63,25 @@ string tGame::executeGame(tAgent* gameAgent, FILE *data_file, bool report)
             // pick new color for this round
             //if ( (i + 1) == round )
             //{
-            colorSequence.push_back(rand() % numColors);
+            if ((numColors & (numColors - 1)) == 0)
+            {
+                colorSequence.push_back((int)gameAgent->rng.nextBits(numInputs));
+            }
+            else
+            {
+                colorSequence.push_back((int)gameAgent->rng.nextInt(numColors));
+            }
             //}
             
             // activate the color
             // indexes between [0, numColors]
             for (int j = 0; j < numInputs; ++j)
             {
-                gameAgent->states[j] = (colorSequence[i] >> j) & 1;
+                gameAgent->setState(j, (colorSequence[i] >> j) & 1);
             }
             
-            gameAgent->states[numInputs] = 1;
-            gameAgent->states[numInputs + 1] = 0;
+            gameAgent->setState(numInputs, 1);
+            gameAgent->setState(numInputs + 1, 0);
             
             // activate the game agent's brain
             gameAgent->updateStates();
@@ -83,15 +92,15 @@ string tGame::executeGame(tAgent* gameAgent, FILE *data_file, bool report)
         {
             for (int j = 0; j < numInputs; ++j)
             {
-                gameAgent->states[j] = 0;
+                gameAgent->setState(j, 0);
             }
-            gameAgent->states[numInputs] = 0;
-            gameAgent->states[numInputs + 1] = 1;
+            gameAgent->setState(numInputs, 0);
+            gameAgent->setState(numInputs + 1, 1);
             
             gameAgent->updateStates();
             
             //int guess = ((gameAgent->states[(maxNodes - 1)] & 1) << 1) + (gameAgent->states[(maxNodes - 2)] & 1);
-            int guess = (gameAgent->states[numInputs + 2] & 1);
+            int guess = gameAgent->getState(numInputs + 2);
 
             if (guess != colorSequence[i])
             {
@@ -124,6 +133,307 @@ string tGame::executeGame(tAgent* gameAgent, FILE *data_file, bool report)
     return reportString;
 }
 
+// plays the given number of independent games with the agent and returns the fitness of each one.
+// for deterministic brains every game scores exactly what executeGame would score with the same colors.
+vector<double> tGame::executeGameBatch(tAgent* gameAgent, int instances)
+{
+    // set up brain
+    gameAgent->ensurePhenotype();
+    
+    return sampleGames(gameAgent, instances);
+}
+
+// expected fitness of a deterministic brain over every one of the numColors^maxRound color sequences.
+// at most maxLanes (1 to 64) sequences share a sliced pass, the rest of each sequence is a shared prefix.
+// if bySequence is given it receives the fitness of every sequence, numbered in base numColors with the
+// first color as the highest digit
+double tGame::executeGameExact(tAgent* gameAgent, int maxLanes, vector<double> *bySequence)
+{
+    // set up brain
+    gameAgent->ensurePhenotype();
+    
+    return enumerateGames(gameAgent, maxLanes, bySequence);
+}
+
+// fitness used for selection: the exact expectation when the brain is deterministic and there are at
+// most exactLimit color sequences, otherwise the average over the given number of random games
+double tGame::evaluateAgent(tAgent* gameAgent, int samples, int exactLimit)
+{
+    // set up brain
+    gameAgent->ensurePhenotype();
+    
+    if (gameAgent->brain.isDeterministic() && sequenceSpaceSize(exactLimit) <= exactLimit)
+    {
+        return enumerateGames(gameAgent, 64, NULL);
+    }
+    
+    vector<double> fitnesses = sampleGames(gameAgent, samples);
+    
+    return sum(fitnesses) / (double)samples;
+}
+
+// rough work of evaluateAgent, for sharing agents out between threads: every
+// batch of up to 64 games takes 2 * maxRound brain updates, each about as
+// expensive as the brain has gates
+double tGame::evaluationCost(tAgent* gameAgent, int samples, int exactLimit)
+{
+    int games = samples;
+    
+    if (gameAgent->brain.isDeterministic() && sequenceSpaceSize(exactLimit) <= exactLimit)
+    {
+        games = sequenceSpaceSize(exactLimit);
+    }
+    
+    return (double)(gameAgent->brain.size() + 1) * (double)(2 * maxRound) * (double)((games + 63) / 64);
+}
+
+// number of distinct color sequences, or limit + 1 if there are more than limit of them
+int tGame::sequenceSpaceSize(int limit)
+{
+    long long size = 1;
+    
+    for (int i = 0; i < maxRound; ++i)
+    {
+        size *= numColors;
+        
+        if (size > limit)
+        {
+            return limit + 1;
+        }
+    }
+    
+    return (int)size;
+}
+
+vector<double> tGame::sampleGames(tAgent* gameAgent, int instances)
+{
+    vector<double> fitnesses(instances, 0.0);
+    int colorSequence[64][maxRound];
+    int correct[64];
+    
+    for (int first = 0; first < instances; first += 64)
+    {
+        const int lanes = (instances - first < 64) ? (instances - first) : 64;
+        
+        // executeGame only ever plays the last round, so every game needs exactly maxRound colors.
+        // they are drawn game by game, in the same order executeGame draws them
+        for (int lane = 0; lane < lanes; ++lane)
+        {
+            for (int i = 0; i < maxRound; ++i)
+            {
+                if ((numColors & (numColors - 1)) == 0)
+                {
+                    colorSequence[lane][i] = (int)gameAgent->rng.nextBits(numInputs);
+                }
+                else
+                {
+                    colorSequence[lane][i] = (int)gameAgent->rng.nextInt(numColors);
+                }
+            }
+        }
+        
+        playSlicedGames(gameAgent, colorSequence, lanes, correct, NULL, 0);
+        
+        for (int lane = 0; lane < lanes; ++lane)
+        {
+            fitnesses[first + lane] = pow(1.2, (double)correct[lane]);
+        }
+    }
+    
+    return fitnesses;
+}
+
+// walks the trie of color sequences depth first. the first colors of a sequence are played once per
+// prefix on the agent's own brain and the state after them is shared by every sequence that starts
+// with them; the last colors, up to maxLanes combinations, are enumerated across the lanes of one sliced pass
+double tGame::enumerateGames(tAgent* gameAgent, int maxLanes, vector<double> *bySequence)
+{
+    const int sequences = sequenceSpaceSize(INT_MAX - 1);
+    int tailLength = 0, tailSize = 1;
+    int prefix[maxRound];
+    double total = 0.0;
+    
+    if (maxLanes > 64)
+    {
+        maxLanes = 64;
+    }
+    
+    while (tailLength < maxRound && tailSize * numColors <= maxLanes)
+    {
+        tailSize *= numColors;
+        ++tailLength;
+    }
+    
+    if (bySequence != NULL)
+    {
+        bySequence->assign(sequences, 0.0);
+    }
+    
+    gameAgent->resetBrain();
+    enumeratePrefixes(gameAgent, prefix, 0, maxRound - tailLength, tailSize, total, bySequence);
+    
+    return total / (double)sequences;
+}
+
+void tGame::enumeratePrefixes(tAgent* gameAgent, int *prefix, int depth, int prefixLength, int tailSize, double &total, vector<double> *bySequence)
+{
+    tBrainState snapshot;
+    
+    gameAgent->saveBrainState(snapshot);
+    
+    if (depth == prefixLength)
+    {
+        int colorSequence[64][maxRound];
+        int correct[64];
+        
+        // tail number t, written in base numColors, with the first tail color as the lowest digit
+        for (int lane = 0; lane < tailSize; ++lane)
+        {
+            int t = lane;
+            
+            for (int i = 0; i < maxRound; ++i)
+            {
+                if (i < prefixLength)
+                {
+                    colorSequence[lane][i] = prefix[i];
+                }
+                else
+                {
+                    colorSequence[lane][i] = t % numColors;
+                    t /= numColors;
+                }
+            }
+        }
+        
+        playSlicedGames(gameAgent, colorSequence, tailSize, correct, &snapshot, prefixLength);
+        
+        for (int lane = 0; lane < tailSize; ++lane)
+        {
+            total += pow(1.2, (double)correct[lane]);
+            
+            if (bySequence != NULL)
+            {
+                int s = 0;
+                
+                for (int i = 0; i < maxRound; ++i)
+                {
+                    s = s * numColors + colorSequence[lane][i];
+                }
+                
+                (*bySequence)[s] = pow(1.2, (double)correct[lane]);
+            }
+        }
+        
+        return;
+    }
+    
+    for (int color = 0; color < numColors; ++color)
+    {
+        gameAgent->restoreBrainState(snapshot);
+        
+        for (int j = 0; j < numInputs; ++j)
+        {
+            gameAgent->setState(j, (color >> j) & 1);
+        }
+        
+        gameAgent->setState(numInputs, 1);
+        gameAgent->setState(numInputs + 1, 0);
+        gameAgent->updateStates();
+        
+        prefix[depth] = color;
+        enumeratePrefixes(gameAgent, prefix, depth + 1, prefixLength, tailSize, total, bySequence);
+    }
+}
+
+// plays one game per color sequence, bit-sliced: bit k of every state word belongs to game k.
+// correct[k] receives the number of colors game k repeated before its first mistake.
+// if start is given, every game continues from that brain state with color firstPosition;
+// otherwise they start from a reset brain with the first color.
+void tGame::playSlicedGames(tAgent* gameAgent, int colorSequence[][maxRound], int lanes, int *correct, const tBrainState *start, int firstPosition)
+{
+    uint64_t states[maxNodes], newStates[maxNodes];
+    const uint64_t allLanes = (lanes == 64) ? ~(uint64_t)0 : (((uint64_t)1 << lanes) - 1);
+    uint64_t alive = allLanes;
+    
+    for (int lane = 0; lane < lanes; ++lane)
+    {
+        correct[lane] = 0;
+    }
+    
+    for (int j = 0; j < maxNodes; ++j)
+    {
+        states[j] = (start != NULL && ((start->states[j >> 6] >> (j & 63)) & 1)) ? allLanes : 0;
+        newStates[j] = 0;
+    }
+    
+    // sequentially feed the color sequences into the game agent's sensors
+    for (int i = firstPosition; i < maxRound; ++i)
+    {
+        for (int j = 0; j < numInputs; ++j)
+        {
+            uint64_t bits = 0;
+            
+            for (int lane = 0; lane < lanes; ++lane)
+            {
+                bits |= (uint64_t)((colorSequence[lane][i] >> j) & 1) << lane;
+            }
+            
+            states[j] = bits;
+        }
+        
+        states[numInputs] = allLanes;
+        states[numInputs + 1] = 0;
+        
+        gameAgent->brain.updateSliced(states, newStates, lanes, &gameAgent->rng);
+        
+        for (int j = 0; j < maxNodes; ++j)
+        {
+            states[j] = newStates[j];
+            newStates[j] = 0;
+        }
+    }
+    
+    gameAgent->totalSteps += (maxRound - firstPosition) * lanes;
+    
+    // check the guessed sequences; a game stops at its first wrong guess
+    for (int i = 0; alive != 0 && i < maxRound; ++i)
+    {
+        uint64_t isZero = 0, isOne = 0;
+        
+        for (int lane = 0; lane < lanes; ++lane)
+        {
+            isZero |= (uint64_t)(colorSequence[lane][i] == 0) << lane;
+            isOne |= (uint64_t)(colorSequence[lane][i] == 1) << lane;
+        }
+        
+        for (int j = 0; j < numInputs; ++j)
+        {
+            states[j] = 0;
+        }
+        states[numInputs] = 0;
+        states[numInputs + 1] = allLanes;
+        
+        gameAgent->brain.updateSliced(states, newStates, lanes, &gameAgent->rng);
+        
+        for (int j = 0; j < maxNodes; ++j)
+        {
+            states[j] = newStates[j];
+            newStates[j] = 0;
+        }
+        
+        const uint64_t guess = states[numInputs + 2];
+        const uint64_t right = alive & ((guess & isOne) | (~guess & isZero));
+        
+        for (int lane = 0; lane < lanes; ++lane)
+        {
+            correct[lane] += (int)((right >> lane) & 1);
+        }
+        
+        gameAgent->totalSteps += __builtin_popcountll(alive);
+        alive = right;
+    }
+}
+
 // sums a vector of values
 double tGame::sum(vector<double> values)
 {
@@ -53,6 +53,11 @@ public:
     tExperiment theExperiment;
     void loadExperiment(char *filename);
     string executeGame(tAgent* swarmAgent, FILE *data_file, bool report);
+    vector<double> executeGameBatch(tAgent* gameAgent, int instances);
+    double executeGameExact(tAgent* gameAgent, int maxLanes, vector<double> *bySequence);
+    double evaluateAgent(tAgent* gameAgent, int samples, int exactLimit);
+    double evaluationCost(tAgent* gameAgent, int samples, int exactLimit);
+    int sequenceSpaceSize(int limit);
     tGame();
     ~tGame();
     double sum(vector<double> values);
@@ -70,5 +75,11 @@ public:
     int neuronsConnectedToPreyRetina(tAgent *agent);
     int neuronsConnectedToPredatorRetina(tAgent* agent);
 
+private:
+    vector<double> sampleGames(tAgent* gameAgent, int instances);
+    double enumerateGames(tAgent* gameAgent, int maxLanes, vector<double> *bySequence);
+    void enumeratePrefixes(tAgent* gameAgent, int *prefix, int depth, int prefixLength, int tailSize, double &total, vector<double> *bySequence);
+    void playSlicedGames(tAgent* gameAgent, int colorSequence[][maxRound], int lanes, int *correct, const tBrainState *start, int firstPosition);
+
 };
 #endif
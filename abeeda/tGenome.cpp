@@ -0,0 +1,333 @@
+/*
+ * tGenome.cpp
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "tGenome.h"
+
+tGenome::tGenome()
+{
+	flat = NULL;
+	length = 0;
+	added = NULL;
+	spare = NULL;
+}
+
+tGenome::~tGenome()
+{
+	for (int i = 0; i < (int)pieces.size(); ++i)
+	{
+		drop(pieces[i].chunk);
+	}
+
+	drop(flat);
+	drop(added);
+	drop(spare);
+}
+
+// empties the genome, keeping a flat chunk nobody else uses for later
+void tGenome::clear(void)
+{
+	if (flat != NULL)
+	{
+		release(flat);
+		flat = NULL;
+	}
+
+	for (int i = 0; i < (int)pieces.size(); ++i)
+	{
+		release(pieces[i].chunk);
+	}
+
+	pieces.clear();
+	length = 0;
+
+	// the mutation bytes can only be reused if no other genome points at them.
+	// otherwise they belong to whoever still does: appending to them could move
+	// the bytes while another thread reads them, so a new chunk is started
+	if (added != NULL)
+	{
+		if (references(added) == 1)
+		{
+			added->bytes.clear();
+		}
+		else
+		{
+			release(added);
+			added = NULL;
+		}
+	}
+}
+
+int tGenome::size(void)
+{
+	return (flat != NULL) ? (int)flat->bytes.size() : length;
+}
+
+// the bytes of a flat genome no other genome refers to, free to be changed in
+// any way, including their number
+vector<unsigned char> &tGenome::edit(void)
+{
+	if (flat == NULL)
+	{
+		flatten();
+	}
+
+	if (references(flat) > 1)
+	{
+		tGenomeChunk *copy = newChunk();
+
+		copy->bytes = flat->bytes;
+		release(flat);
+		flat = copy;
+	}
+
+	return flat->bytes;
+}
+
+// makes this genome a copy of from, sharing from's bytes
+void tGenome::share(tGenome &from)
+{
+	clear();
+
+	// an empty genome has no pieces
+	if ((from.flat != NULL) && from.flat->bytes.empty())
+	{
+		return;
+	}
+
+	if (from.flat != NULL)
+	{
+		tGenomePiece piece;
+
+		piece.chunk = from.flat;
+		piece.start = 0;
+		piece.length = (int)from.flat->bytes.size();
+		__sync_fetch_and_add(&from.flat->refs, 1);
+		pieces.push_back(piece);
+		length = piece.length;
+	}
+	else
+	{
+		pieces = from.pieces;
+		length = from.length;
+
+		for (int i = 0; i < (int)pieces.size(); ++i)
+		{
+			__sync_fetch_and_add(&pieces[i].chunk->refs, 1);
+		}
+	}
+}
+
+void tGenome::set(int position, unsigned char value)
+{
+	// a flat chunk of our own can be written in place
+	if ((flat != NULL) && (references(flat) == 1))
+	{
+		flat->bytes[position] = value;
+		return;
+	}
+
+	if (added == NULL)
+	{
+		added = newChunk();
+	}
+
+	int i = split(position);
+	split(position + 1);
+
+	release(pieces[i].chunk);
+	pieces[i].chunk = added;
+	pieces[i].start = (int)added->bytes.size();
+	pieces[i].length = 1;
+	__sync_fetch_and_add(&added->refs, 1);
+	added->bytes.push_back(value);
+}
+
+// inserts a copy of [start, start + width) at offset
+void tGenome::duplicate(int start, int width, int offset)
+{
+	int a = split(start);
+	int b = split(start + width);
+
+	scratch.assign(pieces.begin() + a, pieces.begin() + b);
+
+	for (int i = 0; i < (int)scratch.size(); ++i)
+	{
+		__sync_fetch_and_add(&scratch[i].chunk->refs, 1);
+	}
+
+	int o = split(offset);
+
+	pieces.insert(pieces.begin() + o, scratch.begin(), scratch.end());
+	length += width;
+}
+
+// removes [start, start + width)
+void tGenome::erase(int start, int width)
+{
+	int a = split(start);
+	int b = split(start + width);
+
+	for (int i = a; i < b; ++i)
+	{
+		release(pieces[i].chunk);
+	}
+
+	pieces.erase(pieces.begin() + a, pieces.begin() + b);
+	length -= width;
+}
+
+// copies the pieces into one flat chunk
+void tGenome::flatten(void)
+{
+	tGenomeChunk *target;
+
+	if (spare != NULL)
+	{
+		target = spare;
+		spare = NULL;
+	}
+	else
+	{
+		target = newChunk();
+	}
+
+	target->bytes.resize(length);
+
+	unsigned char *out = (length > 0) ? &target->bytes[0] : NULL;
+
+	for (int i = 0; i < (int)pieces.size(); ++i)
+	{
+		memcpy(out, &pieces[i].chunk->bytes[pieces[i].start], pieces[i].length);
+		out += pieces[i].length;
+		release(pieces[i].chunk);
+	}
+
+	pieces.clear();
+	flat = target;
+}
+
+void tGenome::toPieces(void)
+{
+	if (flat == NULL)
+	{
+		return;
+	}
+
+	length = (int)flat->bytes.size();
+
+	if (length > 0)
+	{
+		tGenomePiece piece;
+
+		piece.chunk = flat;
+		piece.start = 0;
+		piece.length = length;
+		pieces.push_back(piece);
+	}
+	else
+	{
+		release(flat);
+	}
+
+	flat = NULL;
+}
+
+// makes sure a piece begins at position and returns its index; mutations come
+// in ascending order, so the pieces are searched from the back
+int tGenome::split(int position)
+{
+	toPieces();
+
+	if (position >= length)
+	{
+		return (int)pieces.size();
+	}
+
+	int end = length;
+
+	for (int i = (int)pieces.size() - 1; i >= 0; --i)
+	{
+		int begin = end - pieces[i].length;
+
+		if (position == begin)
+		{
+			return i;
+		}
+
+		if (position > begin)
+		{
+			tGenomePiece tail = pieces[i];
+
+			tail.start += position - begin;
+			tail.length = end - position;
+			pieces[i].length = position - begin;
+			__sync_fetch_and_add(&tail.chunk->refs, 1);
+			pieces.insert(pieces.begin() + i + 1, tail);
+
+			return i + 1;
+		}
+
+		end = begin;
+	}
+
+	return 0;
+}
+
+tGenomeChunk *tGenome::newChunk(void)
+{
+	tGenomeChunk *chunk = new tGenomeChunk;
+
+	chunk->refs = 1;
+
+	return chunk;
+}
+
+// gives up one reference; the last one keeps the chunk as spare if there is none yet
+void tGenome::release(tGenomeChunk *chunk)
+{
+	if (__sync_sub_and_fetch(&chunk->refs, 1) == 0)
+	{
+		if ((spare == NULL) && (chunk != added))
+		{
+			chunk->refs = 1;
+			spare = chunk;
+		}
+		else
+		{
+			delete chunk;
+		}
+	}
+}
+
+void tGenome::drop(tGenomeChunk *chunk)
+{
+	if ((chunk != NULL) && (__sync_sub_and_fetch(&chunk->refs, 1) == 0))
+	{
+		delete chunk;
+	}
+}
+
+// the reference count as other threads may be changing it
+int tGenome::references(tGenomeChunk *chunk)
+{
+	return __sync_fetch_and_add(&chunk->refs, 0);
+}
@@ -0,0 +1,105 @@
+/*
+ * tGenome.h
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _tGenome_h_included_
+#define _tGenome_h_included_
+
+#include <stdlib.h>
+#include <vector>
+
+using namespace std;
+
+// bytes shared between genomes. bytes are only ever appended, never changed,
+// so a piece stays valid for as long as it holds a reference. offspring of
+// the same parent are built on different threads, so refs is only changed
+// with atomic operations.
+class tGenomeChunk{
+public:
+	vector<unsigned char> bytes;
+	int refs;
+};
+
+// length bytes of chunk, starting at start
+class tGenomePiece{
+public:
+	tGenomeChunk *chunk;
+	int start, length;
+};
+
+// a genome kept either as one flat chunk or as a list of pieces of other
+// chunks (a piece table). an offspring starts out as a single piece pointing
+// at its parent's bytes; point mutations, duplications and deletions only
+// edit the piece list. the bytes are copied into a flat chunk of the genome's
+// own the first time they are read.
+class tGenome{
+public:
+	tGenome();
+	~tGenome();
+	int size(void);
+	// the bytes in one piece of memory, for reading; flattens the genome if needed
+	inline const vector<unsigned char> &bytes(void)
+	{
+		if (flat == NULL)
+		{
+			flatten();
+		}
+
+		return flat->bytes;
+	}
+	inline unsigned char operator[](int i)
+	{
+		return bytes()[i];
+	}
+
+private:
+	// only tAgent changes genomes, so that it can note that the phenotype
+	// needs to be rebuilt; tSelfCheck checks the edits against a flat copy
+	friend class tAgent;
+	friend class tSelfCheck;
+
+	// exactly one of flat and pieces is in use
+	tGenomeChunk *flat;
+	vector<tGenomePiece> pieces;
+	int length;
+	// chunk receiving the bytes of point mutations
+	tGenomeChunk *added;
+	// a flat chunk nobody else uses anymore, kept to flatten into next time
+	tGenomeChunk *spare;
+	vector<tGenomePiece> scratch;
+
+	tGenome(const tGenome &other);
+	tGenome &operator=(const tGenome &other);
+	void clear(void);
+	vector<unsigned char> &edit(void);
+	void share(tGenome &from);
+	void set(int position, unsigned char value);
+	void duplicate(int start, int width, int offset);
+	void erase(int start, int width);
+	void flatten(void);
+	void toPieces(void);
+	int split(int position);
+	tGenomeChunk *newChunk(void);
+	void release(tGenomeChunk *chunk);
+	static void drop(tGenomeChunk *chunk);
+	static int references(tGenomeChunk *chunk);
+};
+
+#endif
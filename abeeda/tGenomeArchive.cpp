@@ -0,0 +1,451 @@
+/*
+ * tGenomeArchive.cpp
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "tGenomeArchive.h"
+#include "tGenomeFile.h"
+
+static const char archiveMagic[8] = { 'S', 'M', 'N', 'A', 'R', 'C', 'H', 'V' };
+static const char archiveFooterMagic[8] = { 'S', 'M', 'N', 'I', 'N', 'D', 'E', 'X' };
+static const uint32_t archiveRecordMagic = 0x52434552;
+
+static void readRecord(const unsigned char *from, tGenomeArchiveRecord &record)
+{
+	record.magic = (uint32_t)tGenomeFile::getWord(from, 4);
+	record.reserved = (uint32_t)tGenomeFile::getWord(from + 4, 4);
+	record.generation = (int64_t)tGenomeFile::getWord(from + 8, 8);
+	record.length = tGenomeFile::getWord(from + 16, 8);
+	record.checksum = tGenomeFile::getWord(from + 24, 8);
+}
+
+static void writeRecord(const tGenomeArchiveRecord &record, unsigned char *to)
+{
+	tGenomeFile::putWord(to, record.magic, 4);
+	tGenomeFile::putWord(to + 4, record.reserved, 4);
+	tGenomeFile::putWord(to + 8, (uint64_t)record.generation, 8);
+	tGenomeFile::putWord(to + 16, record.length, 8);
+	tGenomeFile::putWord(to + 24, record.checksum, 8);
+}
+
+static bool writeAt(int fd, const void *buffer, size_t length, uint64_t offset)
+{
+	const char *p = (const char *)buffer;
+
+	while (length > 0)
+	{
+		ssize_t written = pwrite(fd, p, length, (off_t)offset);
+
+		if (written <= 0)
+		{
+			return false;
+		}
+
+		p += written;
+		length -= (size_t)written;
+		offset += (uint64_t)written;
+	}
+
+	return true;
+}
+
+tGenomeArchive::tGenomeArchive()
+{
+	fd = -1;
+	map = NULL;
+	mapLength = 0;
+	endOfRecords = 0;
+}
+
+tGenomeArchive::~tGenomeArchive()
+{
+	close();
+}
+
+bool tGenomeArchive::create(const char *filename)
+{
+	unsigned char header[genomeArchiveHeaderSize];
+
+	close();
+
+	fd = ::open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	memcpy(header, archiveMagic, sizeof(archiveMagic));
+	tGenomeFile::putWord(header + 8, genomeArchiveVersion, 4);
+	tGenomeFile::putWord(header + 12, genomeArchiveHeaderSize, 4);
+
+	endOfRecords = genomeArchiveHeaderSize;
+
+	return writeAt(fd, header, sizeof(header), 0) && writeIndex();
+}
+
+// continues an archive where a checkpoint left it: the records of later
+// generations are dropped, since the resumed run appends them again
+bool tGenomeArchive::resume(const char *filename, int lastGeneration)
+{
+	vector<tGenomeArchiveEntry> kept;
+	uint64_t end;
+
+	if (!open(filename))
+	{
+		return create(filename);
+	}
+
+	end = endOfRecords;
+
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		if (entries[i].generation > lastGeneration)
+		{
+			end = entries[i].offset;
+			break;
+		}
+
+		kept.push_back(entries[i]);
+	}
+
+	close();
+
+	fd = ::open(filename, O_RDWR);
+
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	entries = kept;
+	endOfRecords = end;
+
+	return writeIndex();
+}
+
+// the genome goes in front of its record header, so a reader walking the
+// records never finds a header whose bytes are not there yet
+bool tGenomeArchive::append(int generation, const vector<unsigned char> &genome)
+{
+	tGenomeArchiveRecord record;
+	unsigned char recordBytes[genomeArchiveRecordSize];
+	tGenomeArchiveEntry entry;
+
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	record.magic = archiveRecordMagic;
+	record.reserved = 0;
+	record.generation = generation;
+	record.length = genome.size();
+	record.checksum = tGenomeFile::checksum(genome.empty() ? NULL : &genome[0], genome.size());
+
+	writeRecord(record, recordBytes);
+
+	if (!genome.empty() && !writeAt(fd, &genome[0], genome.size(), endOfRecords + sizeof(recordBytes)))
+	{
+		return false;
+	}
+
+	if (!writeAt(fd, recordBytes, sizeof(recordBytes), endOfRecords))
+	{
+		return false;
+	}
+
+	entry.generation = generation;
+	entry.offset = endOfRecords;
+	entries.push_back(entry);
+	endOfRecords += sizeof(recordBytes) + genome.size();
+
+	return writeIndex();
+}
+
+bool tGenomeArchive::writeIndex(void)
+{
+	vector<unsigned char> index(entries.size() * genomeArchiveEntrySize + genomeArchiveFooterSize);
+	unsigned char *footer = &index[entries.size() * genomeArchiveEntrySize];
+
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		tGenomeFile::putWord(&index[i * genomeArchiveEntrySize], (uint64_t)entries[i].generation, 8);
+		tGenomeFile::putWord(&index[i * genomeArchiveEntrySize + 8], entries[i].offset, 8);
+	}
+
+	tGenomeFile::putWord(footer, endOfRecords, 8);
+	tGenomeFile::putWord(footer + 8, entries.size(), 8);
+	tGenomeFile::putWord(footer + 16, tGenomeFile::checksum(&index[0], footer - &index[0]), 8);
+	memcpy(footer + 24, archiveFooterMagic, sizeof(archiveFooterMagic));
+
+	return writeAt(fd, &index[0], index.size(), endOfRecords)
+		&& ftruncate(fd, (off_t)(endOfRecords + index.size())) == 0;
+}
+
+// maps an archive for reading. what a run appends after this call is not seen.
+bool tGenomeArchive::open(const char *filename)
+{
+	struct stat st;
+	int file;
+
+	close();
+
+	file = ::open(filename, O_RDONLY);
+
+	if (file < 0)
+	{
+		return false;
+	}
+
+	if (fstat(file, &st) != 0 || (size_t)st.st_size < genomeArchiveHeaderSize)
+	{
+		::close(file);
+		return false;
+	}
+
+	mapLength = (size_t)st.st_size;
+	map = mmap(NULL, mapLength, PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+
+	if (map == MAP_FAILED)
+	{
+		map = NULL;
+		mapLength = 0;
+		return false;
+	}
+
+	tGenomeArchiveHeader header;
+
+	memcpy(header.magic, map, sizeof(header.magic));
+	header.version = (uint32_t)tGenomeFile::getWord((const unsigned char *)map + 8, 4);
+	header.headerSize = (uint32_t)tGenomeFile::getWord((const unsigned char *)map + 12, 4);
+
+	if (memcmp(header.magic, archiveMagic, sizeof(archiveMagic)) != 0
+		|| header.version > genomeArchiveVersion
+		|| header.headerSize < genomeArchiveHeaderSize
+		|| header.headerSize > mapLength)
+	{
+		close();
+		return false;
+	}
+
+	if (!readIndex())
+	{
+		scanRecords();
+	}
+
+	return true;
+}
+
+bool tGenomeArchive::readIndex(void)
+{
+	const unsigned char *base = (const unsigned char *)map;
+	tGenomeArchiveFooter footer;
+
+	if (mapLength < genomeArchiveHeaderSize + genomeArchiveFooterSize)
+	{
+		return false;
+	}
+
+	const unsigned char *end = base + mapLength - genomeArchiveFooterSize;
+
+	footer.indexOffset = tGenomeFile::getWord(end, 8);
+	footer.count = tGenomeFile::getWord(end + 8, 8);
+	footer.checksum = tGenomeFile::getWord(end + 16, 8);
+	memcpy(footer.magic, end + 24, sizeof(footer.magic));
+
+	if (memcmp(footer.magic, archiveFooterMagic, sizeof(archiveFooterMagic)) != 0
+		|| footer.count > mapLength / genomeArchiveEntrySize
+		|| footer.indexOffset + footer.count * genomeArchiveEntrySize + genomeArchiveFooterSize != mapLength)
+	{
+		return false;
+	}
+
+	const unsigned char *index = base + footer.indexOffset;
+	size_t indexLength = (size_t)footer.count * genomeArchiveEntrySize;
+
+	if (tGenomeFile::checksum(index, indexLength) != footer.checksum)
+	{
+		return false;
+	}
+
+	entries.resize((size_t)footer.count);
+
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		entries[i].generation = (int64_t)tGenomeFile::getWord(index + i * genomeArchiveEntrySize, 8);
+		entries[i].offset = tGenomeFile::getWord(index + i * genomeArchiveEntrySize + 8, 8);
+
+		if (entries[i].offset + genomeArchiveRecordSize > footer.indexOffset)
+		{
+			entries.clear();
+			return false;
+		}
+	}
+
+	endOfRecords = footer.indexOffset;
+
+	return true;
+}
+
+// rebuilds the index from the records themselves, up to the first one that
+// is not complete
+void tGenomeArchive::scanRecords(void)
+{
+	const unsigned char *base = (const unsigned char *)map;
+	uint64_t offset = tGenomeFile::getWord(base + 12, 4);
+	tGenomeArchiveRecord record;
+	tGenomeArchiveEntry entry;
+
+	entries.clear();
+
+	while (offset + genomeArchiveRecordSize <= mapLength)
+	{
+		readRecord(base + offset, record);
+
+		if (record.magic != archiveRecordMagic || record.length > mapLength - offset - genomeArchiveRecordSize)
+		{
+			break;
+		}
+
+		entry.generation = record.generation;
+		entry.offset = offset;
+		entries.push_back(entry);
+		offset += genomeArchiveRecordSize + record.length;
+	}
+
+	endOfRecords = offset;
+}
+
+// index of the genome saved in the given generation, -1 if there is none.
+// tracked generations are evenly spaced, so the first guess normally hits.
+int tGenomeArchive::find(int generation) const
+{
+	int n = (int)entries.size();
+
+	if (n == 0)
+	{
+		return -1;
+	}
+
+	if (n > 1)
+	{
+		int64_t step = (entries[n - 1].generation - entries[0].generation) / (n - 1);
+
+		if (step > 0 && (generation - entries[0].generation) % step == 0)
+		{
+			int64_t guess = (generation - entries[0].generation) / step;
+
+			if (guess >= 0 && guess < n && entries[guess].generation == generation)
+			{
+				return (int)guess;
+			}
+		}
+	}
+
+	int low = 0, high = n - 1;
+
+	while (low <= high)
+	{
+		int middle = (low + high) / 2;
+
+		if (entries[middle].generation == generation)
+		{
+			return middle;
+		}
+		else if (entries[middle].generation < generation)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle - 1;
+		}
+	}
+
+	return -1;
+}
+
+// the bytes of genome i inside the mapping
+const unsigned char *tGenomeArchive::data(int i, size_t &length) const
+{
+	const unsigned char *base = (const unsigned char *)map;
+	tGenomeArchiveRecord record;
+
+	readRecord(base + entries[i].offset, record);
+	length = (size_t)record.length;
+
+	return base + entries[i].offset + genomeArchiveRecordSize;
+}
+
+// copies genome i out of the archive, checking it against its checksum
+bool tGenomeArchive::load(int i, vector<unsigned char> &genome) const
+{
+	const unsigned char *base = (const unsigned char *)map;
+	tGenomeArchiveRecord record;
+	const unsigned char *bytes;
+
+	if (i < 0 || i >= (int)entries.size())
+	{
+		return false;
+	}
+
+	readRecord(base + entries[i].offset, record);
+
+	if (record.magic != archiveRecordMagic || record.length > mapLength - entries[i].offset - genomeArchiveRecordSize)
+	{
+		return false;
+	}
+
+	bytes = base + entries[i].offset + genomeArchiveRecordSize;
+
+	if (tGenomeFile::checksum(bytes, (size_t)record.length) != record.checksum)
+	{
+		return false;
+	}
+
+	genome.assign(bytes, bytes + record.length);
+
+	return true;
+}
+
+void tGenomeArchive::close(void)
+{
+	if (fd >= 0)
+	{
+		::close(fd);
+	}
+
+	if (map != NULL)
+	{
+		munmap(map, mapLength);
+	}
+
+	fd = -1;
+	map = NULL;
+	mapLength = 0;
+	endOfRecords = 0;
+	entries.clear();
+}
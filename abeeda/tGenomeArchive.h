@@ -0,0 +1,116 @@
+/*
+ * tGenomeArchive.h
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _tGenomeArchive_h_included_
+#define _tGenomeArchive_h_included_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+using namespace std;
+
+#define genomeArchiveVersion 1
+
+// on disk every number is stored most significant byte first, whatever
+// machine wrote it; these are the sizes of the parts below in the file
+#define genomeArchiveHeaderSize 16
+#define genomeArchiveRecordSize 32
+#define genomeArchiveEntrySize 16
+#define genomeArchiveFooterSize 32
+
+class tGenomeArchiveHeader{
+public:
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize;
+};
+
+// precedes the bytes of every genome in the archive
+class tGenomeArchiveRecord{
+public:
+	uint32_t magic;
+	uint32_t reserved;
+	int64_t generation;
+	uint64_t length;
+	uint64_t checksum;
+};
+
+class tGenomeArchiveEntry{
+public:
+	int64_t generation;
+	uint64_t offset;
+};
+
+// the last bytes of a closed or up to date archive
+class tGenomeArchiveFooter{
+public:
+	uint64_t indexOffset;
+	uint64_t count;
+	uint64_t checksum;
+	char magic[8];
+};
+
+// many genomes in one file, one per tracked generation. the file is a header,
+// the genome records in the order they were added, an index from generation
+// to record offset and a footer locating the index. records are never
+// touched again once written; only the index behind them is replaced by a
+// longer one on every append.
+//
+// a reader that finds no intact index (the run is writing the next record
+// right now, or died) walks the records from the front instead, so an
+// archive can be read at any time.
+class tGenomeArchive{
+public:
+	tGenomeArchive();
+	~tGenomeArchive();
+
+	// writing
+	bool create(const char *filename);
+	bool resume(const char *filename, int lastGeneration);
+	bool append(int generation, const vector<unsigned char> &genome);
+
+	// reading
+	bool open(const char *filename);
+	int size(void) const { return (int)entries.size(); }
+	int generation(int i) const { return (int)entries[i].generation; }
+	int find(int generation) const;
+	const unsigned char *data(int i, size_t &length) const;
+	bool load(int i, vector<unsigned char> &genome) const;
+
+	void close(void);
+
+private:
+	int fd;
+	void *map;
+	size_t mapLength;
+	uint64_t endOfRecords;
+	vector<tGenomeArchiveEntry> entries;
+
+	bool writeIndex(void);
+	bool readIndex(void);
+	void scanRecords(void);
+
+	tGenomeArchive(const tGenomeArchive &);
+	tGenomeArchive &operator=(const tGenomeArchive &);
+};
+
+#endif
@@ -0,0 +1,191 @@
+/*
+ * tGenomeDelta.cpp
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include "tGenomeDelta.h"
+#include "tCheckpoint.h"
+
+tGenomeDelta::tGenomeDelta()
+{
+	clear();
+}
+
+void tGenomeDelta::clear(void)
+{
+	pointPositions.clear();
+	pointValues.clear();
+	duplicationStart = 0;
+	duplicationWidth = 0;
+	duplicationOffset = 0;
+	deletionStart = 0;
+	deletionWidth = 0;
+	replacement.clear();
+}
+
+// true if bytes moved, i.e. the genome length or the position of some bytes changed
+bool tGenomeDelta::isStructural(void)
+{
+	return (duplicationWidth > 0) || (deletionWidth > 0) || !replacement.empty();
+}
+
+// where the byte at the given parent position ended up in the offspring, or -1 if it was deleted
+int tGenomeDelta::mapPosition(int position)
+{
+	if (duplicationWidth > 0 && position >= duplicationOffset)
+	{
+		position += duplicationWidth;
+	}
+
+	if (deletionWidth > 0 && position >= deletionStart)
+	{
+		if (position < deletionStart + deletionWidth)
+		{
+			return -1;
+		}
+
+		position -= deletionWidth;
+	}
+
+	return position;
+}
+
+// true if a point mutation hit parent positions [start, end); end may run past the
+// end of the genome, in which case the gene wraps around to its beginning
+bool tGenomeDelta::isPointMutated(int start, int end, int parentSize)
+{
+	vector<int>::iterator it = lower_bound(pointPositions.begin(), pointPositions.end(), start);
+
+	if (it != pointPositions.end() && *it < end)
+	{
+		return true;
+	}
+
+	return (end > parentSize) && !pointPositions.empty() && (pointPositions[0] < end - parentSize);
+}
+
+// where a gene that covers parent positions [start, start + length) begins in the offspring,
+// or -1 if any of its bytes was mutated or deleted, or the gene was cut apart or wraps around
+// the end of a genome that changed length
+int tGenomeDelta::mapGene(int start, int length, int parentSize, int childSize)
+{
+	int end = start + length;
+
+	if (isPointMutated(start, end, parentSize))
+	{
+		return -1;
+	}
+
+	if (!isStructural())
+	{
+		return start;
+	}
+
+	if (end > parentSize)
+	{
+		return -1;
+	}
+
+	if (duplicationWidth > 0)
+	{
+		if (start < duplicationOffset && duplicationOffset < end)
+		{
+			return -1;
+		}
+
+		if (start >= duplicationOffset)
+		{
+			start += duplicationWidth;
+			end += duplicationWidth;
+		}
+	}
+
+	if (deletionWidth > 0)
+	{
+		if (start < deletionStart + deletionWidth && end > deletionStart)
+		{
+			return -1;
+		}
+
+		if (start >= deletionStart + deletionWidth)
+		{
+			start -= deletionWidth;
+			end -= deletionWidth;
+		}
+	}
+
+	if (end > childSize)
+	{
+		return -1;
+	}
+
+	return start;
+}
+
+// turns the parent's genome into the offspring's
+void tGenomeDelta::apply(vector<unsigned char> &genome)
+{
+	if (!replacement.empty())
+	{
+		genome = replacement;
+		return;
+	}
+
+	for (int i = 0; i < (int)pointPositions.size(); ++i)
+	{
+		genome[pointPositions[i]] = pointValues[i];
+	}
+
+	if (duplicationWidth > 0)
+	{
+		vector<unsigned char> buffer(genome.begin() + duplicationStart, genome.begin() + duplicationStart + duplicationWidth);
+
+		genome.insert(genome.begin() + duplicationOffset, buffer.begin(), buffer.end());
+	}
+
+	if (deletionWidth > 0)
+	{
+		genome.erase(genome.begin() + deletionStart, genome.begin() + deletionStart + deletionWidth);
+	}
+}
+
+void tGenomeDelta::saveState(tCheckpoint &checkpoint)
+{
+	checkpoint.putIntVector(pointPositions);
+	checkpoint.putByteVector(pointValues);
+	checkpoint.putInt(duplicationStart);
+	checkpoint.putInt(duplicationWidth);
+	checkpoint.putInt(duplicationOffset);
+	checkpoint.putInt(deletionStart);
+	checkpoint.putInt(deletionWidth);
+	checkpoint.putByteVector(replacement);
+}
+
+void tGenomeDelta::loadState(tCheckpoint &checkpoint)
+{
+	checkpoint.getIntVector(pointPositions);
+	checkpoint.getByteVector(pointValues);
+	duplicationStart = checkpoint.getInt();
+	duplicationWidth = checkpoint.getInt();
+	duplicationOffset = checkpoint.getInt();
+	deletionStart = checkpoint.getInt();
+	deletionWidth = checkpoint.getInt();
+	checkpoint.getByteVector(replacement);
+}
@@ -0,0 +1,57 @@
+/*
+ * tGenomeDelta.h
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _tGenomeDelta_h_included_
+#define _tGenomeDelta_h_included_
+
+#include <vector>
+
+using namespace std;
+
+class tCheckpoint;
+
+// the mutations that turned a parent genome into its offspring's genome, in the order
+// tAgent::inherit applies them: point mutations (ascending positions), then an optional
+// duplication that inserts a copy of [duplicationStart, duplicationStart + duplicationWidth)
+// at duplicationOffset, then an optional deletion of [deletionStart, deletionStart + deletionWidth).
+// positions of each step refer to the genome as it was before that step.
+// a migrant from another island has no parent here; its delta holds the whole
+// genome as a replacement instead.
+class tGenomeDelta{
+public:
+	vector<int> pointPositions;
+	vector<unsigned char> pointValues;
+	int duplicationStart, duplicationWidth, duplicationOffset;
+	int deletionStart, deletionWidth;
+	vector<unsigned char> replacement;
+
+	tGenomeDelta();
+	void clear(void);
+	bool isStructural(void);
+	int mapPosition(int position);
+	int mapGene(int start, int length, int parentSize, int childSize);
+	bool isPointMutated(int start, int end, int parentSize);
+	void apply(vector<unsigned char> &genome);
+	void saveState(tCheckpoint &checkpoint);
+	void loadState(tCheckpoint &checkpoint);
+};
+
+#endif
@@ -0,0 +1,285 @@
+/*
+ * tGenomeFile.cpp
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "tGenomeFile.h"
+
+static const char genomeFileMagic[8] = { 'S', 'M', 'N', 'G', 'E', 'N', 'O', 'M' };
+
+static void readHeader(const unsigned char *from, tGenomeFileHeader &header)
+{
+	memcpy(header.magic, from, sizeof(header.magic));
+	header.version = (uint32_t)tGenomeFile::getWord(from + 8, 4);
+	header.headerSize = (uint32_t)tGenomeFile::getWord(from + 12, 4);
+	header.length = tGenomeFile::getWord(from + 16, 8);
+	header.checksum = tGenomeFile::getWord(from + 24, 8);
+}
+
+static void writeHeader(const tGenomeFileHeader &header, unsigned char *to)
+{
+	memcpy(to, header.magic, sizeof(header.magic));
+	tGenomeFile::putWord(to + 8, header.version, 4);
+	tGenomeFile::putWord(to + 12, header.headerSize, 4);
+	tGenomeFile::putWord(to + 16, header.length, 8);
+	tGenomeFile::putWord(to + 24, header.checksum, 8);
+}
+
+tGenomeFile::tGenomeFile()
+{
+	map = NULL;
+	mapLength = 0;
+	bytes = NULL;
+	length = 0;
+}
+
+tGenomeFile::~tGenomeFile()
+{
+	close();
+}
+
+// maps a binary genome file. fails if the file is not one, was written by a
+// newer version or does not hold the number of bytes and the checksum its
+// header promises.
+bool tGenomeFile::open(const char *filename)
+{
+	struct stat st;
+	int fd;
+
+	close();
+
+	fd = ::open(filename, O_RDONLY);
+
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < genomeFileHeaderSize)
+	{
+		::close(fd);
+		return false;
+	}
+
+	mapLength = (size_t)st.st_size;
+	map = mmap(NULL, mapLength, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+
+	if (map == MAP_FAILED)
+	{
+		map = NULL;
+		mapLength = 0;
+		return false;
+	}
+
+	tGenomeFileHeader header;
+
+	readHeader((const unsigned char *)map, header);
+
+	if (memcmp(header.magic, genomeFileMagic, sizeof(genomeFileMagic)) != 0
+		|| header.version > genomeFileVersion
+		|| header.headerSize < genomeFileHeaderSize
+		|| header.headerSize > mapLength
+		|| header.length != mapLength - header.headerSize)
+	{
+		close();
+		return false;
+	}
+
+	bytes = (const unsigned char *)map + header.headerSize;
+	length = (size_t)header.length;
+
+	if (checksum(bytes, length) != header.checksum)
+	{
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void tGenomeFile::close(void)
+{
+	if (map != NULL)
+	{
+		munmap(map, mapLength);
+	}
+
+	map = NULL;
+	mapLength = 0;
+	bytes = NULL;
+	length = 0;
+}
+
+bool tGenomeFile::isBinary(const char *filename)
+{
+	char magic[sizeof(genomeFileMagic)];
+	FILE *f = fopen(filename, "rb");
+	bool binary;
+
+	if (f == NULL)
+	{
+		return false;
+	}
+
+	binary = fread(magic, 1, sizeof(magic), f) == sizeof(magic) && memcmp(magic, genomeFileMagic, sizeof(magic)) == 0;
+	fclose(f);
+
+	return binary;
+}
+
+// reads a genome in either format. the bytes of a binary file are copied out
+// of the mapping, since the genome owns its bytes; code that only reads a
+// genome can use open() and data() and skip the copy.
+bool tGenomeFile::load(const char *filename, vector<unsigned char> &genome)
+{
+	if (isBinary(filename))
+	{
+		tGenomeFile file;
+
+		if (!file.open(filename))
+		{
+			return false;
+		}
+
+		genome.assign(file.data(), file.data() + file.size());
+
+		return true;
+	}
+
+	return loadText(filename, genome);
+}
+
+bool tGenomeFile::loadText(const char *filename, vector<unsigned char> &genome)
+{
+	FILE *f = fopen(filename, "r");
+	int i;
+
+	if (f == NULL)
+	{
+		return false;
+	}
+
+	genome.clear();
+
+	// stop on the first thing that is not a number; testing feof() instead
+	// would append the last number a second time when the file ends in blanks
+	while (fscanf(f, "%i", &i) == 1)
+	{
+		genome.push_back((unsigned char)(i & 255));
+	}
+
+	fclose(f);
+
+	return true;
+}
+
+// writes to a temporary name first, so a reader never maps a half written file
+bool tGenomeFile::saveBinary(const char *filename, const unsigned char *genome, size_t genomeLength)
+{
+	tGenomeFileHeader header;
+	unsigned char headerBytes[genomeFileHeaderSize];
+	string temporary = string(filename) + ".tmp";
+	FILE *f = fopen(temporary.c_str(), "wb");
+	bool written;
+
+	if (f == NULL)
+	{
+		return false;
+	}
+
+	memcpy(header.magic, genomeFileMagic, sizeof(genomeFileMagic));
+	header.version = genomeFileVersion;
+	header.headerSize = genomeFileHeaderSize;
+	header.length = genomeLength;
+	header.checksum = checksum(genome, genomeLength);
+	writeHeader(header, headerBytes);
+
+	written = fwrite(headerBytes, sizeof(headerBytes), 1, f) == 1
+		&& (genomeLength == 0 || fwrite(genome, genomeLength, 1, f) == 1);
+	written = (fclose(f) == 0) && written;
+
+	if (!written || rename(temporary.c_str(), filename) != 0)
+	{
+		remove(temporary.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool tGenomeFile::saveText(const char *filename, const unsigned char *genome, size_t genomeLength)
+{
+	FILE *f = fopen(filename, "w");
+
+	if (f == NULL)
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < genomeLength; ++i)
+	{
+		fprintf(f, "%i	", genome[i]);
+	}
+
+	fprintf(f, "\n");
+
+	return fclose(f) == 0;
+}
+
+// 64-bit FNV-1a
+uint64_t tGenomeFile::checksum(const unsigned char *genome, size_t genomeLength)
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	for (size_t i = 0; i < genomeLength; ++i)
+	{
+		hash ^= genome[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+void tGenomeFile::putWord(unsigned char *to, uint64_t value, int bytes)
+{
+	for (int i = 0; i < bytes; ++i)
+	{
+		to[i] = (unsigned char)(value >> (8 * (bytes - 1 - i)));
+	}
+}
+
+uint64_t tGenomeFile::getWord(const unsigned char *from, int bytes)
+{
+	uint64_t value = 0;
+
+	for (int i = 0; i < bytes; ++i)
+	{
+		value = (value << 8) | from[i];
+	}
+
+	return value;
+}
@@ -0,0 +1,81 @@
+/*
+ * tGenomeFile.h
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _tGenomeFile_h_included_
+#define _tGenomeFile_h_included_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+using namespace std;
+
+#define genomeFileVersion 1
+
+// header of a binary genome file; the genome bytes follow it directly. on
+// disk the numbers are stored most significant byte first, whatever machine
+// wrote them, so the header takes genomeFileHeaderSize bytes.
+#define genomeFileHeaderSize 32
+
+class tGenomeFileHeader{
+public:
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize;
+	uint64_t length;
+	uint64_t checksum;
+};
+
+// a genome file mapped into memory. data() points straight into the mapping,
+// so reading a binary genome costs no parsing and no copy. text genomes (one
+// tab separated number per byte, as the program always wrote them) can be
+// read and written as well, so old files keep working.
+class tGenomeFile{
+public:
+	tGenomeFile();
+	~tGenomeFile();
+
+	bool open(const char *filename);
+	void close(void);
+	const unsigned char *data(void) const { return bytes; }
+	size_t size(void) const { return length; }
+
+	static bool isBinary(const char *filename);
+	static bool load(const char *filename, vector<unsigned char> &genome);
+	static bool loadText(const char *filename, vector<unsigned char> &genome);
+	static bool saveBinary(const char *filename, const unsigned char *genome, size_t genomeLength);
+	static bool saveText(const char *filename, const unsigned char *genome, size_t genomeLength);
+	static uint64_t checksum(const unsigned char *genome, size_t genomeLength);
+	// numbers in files, most significant byte first
+	static void putWord(unsigned char *to, uint64_t value, int bytes);
+	static uint64_t getWord(const unsigned char *from, int bytes);
+
+private:
+	void *map;
+	size_t mapLength;
+	const unsigned char *bytes;
+	size_t length;
+
+	tGenomeFile(const tGenomeFile &);
+	tGenomeFile &operator=(const tGenomeFile &);
+};
+
+#endif
@@ -38,7 +38,7 @@ tHMMU::~tHMMU(){
 	chosenOutPos.clear();
 	chosenOutNeg.clear();
 }
-void tHMMU::setup(vector<unsigned char> &genome, int start){
+void tHMMU::setup(const vector<unsigned char> &genome, int start){
 	int i,j,k;
 	ins.clear();
 	outs.clear();
@@ -73,6 +73,7 @@ void tHMMU::setup(vector<unsigned char> &genome, int start){
 	sums.resize(1<<_yDim);
 	for(i=0;i<(1<<_yDim);i++){
 		hmm[i].resize(1<<_xDim);
+		sums[i]=0;
 		for(j=0;j<(1<<_xDim);j++){
 //			hmm[i][j]=(genome[(k+j+((1<<yDim)*i))%genome.size()]&1)*255;
 			hmm[i][j]=genome[(k+j+((1<<_xDim)*i))%genome.size()];
@@ -82,7 +83,7 @@ void tHMMU::setup(vector<unsigned char> &genome, int start){
 	}
 }
 
-void tHMMU::setupQuick(vector<unsigned char> &genome, int start){
+void tHMMU::setupQuick(const vector<unsigned char> &genome, int start){
 	int i,j,k;
 	ins.clear();
 	outs.clear();
@@ -125,7 +126,7 @@ void tHMMU::setupQuick(vector<unsigned char> &genome, int start){
 	
 }
 
-void tHMMU::update(unsigned char *states, unsigned char *newStates,unsigned char *nodeMap)
+void tHMMU::update(unsigned char *states, unsigned char *newStates,unsigned char *nodeMap,tRandom *rng)
 {
 	int I=0;
 	int i,j,r;
@@ -136,7 +137,7 @@ void tHMMU::update(unsigned char *states, unsigned char *newStates,unsigned char
     {
 		for(i=0;i<chosenInPos.size();i++)
         {
-			mod=(unsigned char)(rand()%(int)posLevelOfFB[i]);
+			mod=(unsigned char)rng->nextInt((unsigned int)posLevelOfFB[i]);
 			if((hmm[chosenInPos[i]][chosenOutPos[i]]+mod)<255)
             {
 				hmm[chosenInPos[i]][chosenOutPos[i]]+=mod;
@@ -148,7 +149,7 @@ void tHMMU::update(unsigned char *states, unsigned char *newStates,unsigned char
     {
 		for(i=0;i<chosenInNeg.size();i++)
         {
-			mod=(unsigned char)(rand()%(int)negLevelOfFB[i]);
+			mod=(unsigned char)rng->nextInt((unsigned int)negLevelOfFB[i]);
 			if((hmm[chosenInNeg[i]][chosenOutNeg[i]]-mod)>0)
             {
 				hmm[chosenInNeg[i]][chosenOutNeg[i]]-=mod;
@@ -163,7 +164,7 @@ void tHMMU::update(unsigned char *states, unsigned char *newStates,unsigned char
 		I=(I<<1)+((states[nodeMap[*it]])&1);
     }
     
-	r=1+(rand()%(sums[I]-1));
+	r=1+(int)rng->nextInt(sums[I]-1);
 	j=0;
     //	cout<<I<<" "<<(int)hmm.size()<<" "<<(int)hmm[0].size()<<endl;
 	while(r > hmm[I][j])
@@ -26,6 +26,7 @@
 #include <deque>
 #include <iostream>
 #include "globalConst.h"
+#include "tRandom.h"
 
 using namespace std;
 
@@ -42,9 +43,9 @@ public:
 	unsigned char _xDim,_yDim;
 	tHMMU();
 	~tHMMU();
-	void setup(vector<unsigned char> &genome, int start);
-	void setupQuick(vector<unsigned char> &genome, int start);
-	void update(unsigned char *states,unsigned char *newStates,unsigned char *nodeMap);
+	void setup(const vector<unsigned char> &genome, int start);
+	void setupQuick(const vector<unsigned char> &genome, int start);
+	void update(unsigned char *states,unsigned char *newStates,unsigned char *nodeMap,tRandom *rng);
 	void show(unsigned char *nodeMap);
 	
 };
@@ -0,0 +1,623 @@
+/*
+ * tIsland.cpp
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include "tIsland.h"
+#include "tGenomeFile.h"
+#include "helper.h"
+
+#define migrationMagic "SMNMIGRT"
+#define migrationHeaderSize 20
+#define migrationRecordSize 12
+// bounds a message must keep to; anything else means the stream is garbage
+#define maxMigrantsPerMessage 1024
+#define maxMigrantLength (1 << 24)
+// how much may pile up while a peer is slow or away
+#define maxOutboxMessages 4
+#define maxInboxGenomes 1024
+// seconds to wait for a connection to the next island, and for the last
+// migrants to get out when the run ends
+#define connectTimeout 10.0
+#define drainTimeout 2.0
+
+static double islandClock(void)
+{
+    struct timespec now;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    return (double)now.tv_sec + 1e-9 * (double)now.tv_nsec;
+}
+
+static bool setNonBlocking(int socket)
+{
+    int flags = fcntl(socket, F_GETFL, 0);
+    
+    return (flags >= 0) && (fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0);
+}
+
+// splits host:port into its parts
+static bool splitAddress(const string &address, string &host, string &port)
+{
+    size_t colon = address.rfind(':');
+    
+    if (colon == string::npos || colon == 0 || colon + 1 == address.size())
+    {
+        return false;
+    }
+    
+    host = address.substr(0, colon);
+    port = address.substr(colon + 1);
+    
+    return atoi(port.c_str()) > 0;
+}
+
+tIsland::tIsland()
+{
+    index = -1;
+    sent = 0;
+    received = 0;
+    dropped = 0;
+    running = false;
+    stopping = false;
+    stopDeadline = 0.0;
+    listenSocket = -1;
+    nextSocket = -1;
+    connecting = false;
+    nextAttempt = 0.0;
+    connectDeadline = 0.0;
+    sendingOffset = 0;
+    memset(&nextAddress, 0, sizeof(nextAddress));
+    pthread_mutex_init(&lock, NULL);
+}
+
+tIsland::~tIsland()
+{
+    stop();
+    pthread_mutex_destroy(&lock);
+}
+
+// a comma separated list of host:port, one per island
+bool tIsland::parsePeers(const char *list, vector<string> &peers)
+{
+    string rest = list, host, port;
+    
+    peers.clear();
+    
+    while (true)
+    {
+        size_t comma = rest.find(',');
+        
+        peers.push_back(rest.substr(0, comma));
+        
+        if (!splitAddress(peers.back(), host, port))
+        {
+            return false;
+        }
+        
+        if (comma == string::npos)
+        {
+            return true;
+        }
+        
+        rest = rest.substr(comma + 1);
+    }
+}
+
+// listens on the address of island islandIndex and starts the network thread.
+// the next island's name is looked up here, since a lookup may block.
+bool tIsland::start(int islandIndex, const vector<string> &peers)
+{
+    string host, port, nextHost, nextPort;
+    struct sockaddr_in address;
+    struct addrinfo hints, *found;
+    int yes = 1;
+    
+    if (islandIndex < 0 || islandIndex >= (int)peers.size() || !splitAddress(peers[islandIndex], host, port) || !splitAddress(peers[(islandIndex + 1) % peers.size()], nextHost, nextPort))
+    {
+        return false;
+    }
+    
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    
+    if (getaddrinfo(nextHost.c_str(), nextPort.c_str(), &hints, &found) != 0)
+    {
+        return false;
+    }
+    
+    memcpy(&nextAddress, found->ai_addr, sizeof(nextAddress));
+    freeaddrinfo(found);
+    
+    if ((listenSocket = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+    {
+        return false;
+    }
+    
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons((unsigned short)atoi(port.c_str()));
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    
+    if (bind(listenSocket, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(listenSocket, LISTENQ) < 0 || !setNonBlocking(listenSocket))
+    {
+        close(listenSocket);
+        listenSocket = -1;
+        return false;
+    }
+    
+    // a peer that goes away must not take this process with it
+    signal(SIGPIPE, SIG_IGN);
+    
+    index = islandIndex;
+    stopping = false;
+    running = (pthread_create(&thread, NULL, &tIsland::networkMain, this) == 0);
+    
+    return running;
+}
+
+// queues the genomes for the next island and returns at once
+void tIsland::send(int generation, const vector<vector<unsigned char> > &genomes)
+{
+    vector<unsigned char> message;
+    
+    encodeMessage(index, generation, genomes, message);
+    
+    pthread_mutex_lock(&lock);
+    outbox.push_back(vector<unsigned char>());
+    outbox.back().swap(message);
+    
+    while (outbox.size() > maxOutboxMessages)
+    {
+        dropped += (int)tGenomeFile::getWord(&outbox.front()[16], 4);
+        outbox.pop_front();
+    }
+    
+    sent += (int)genomes.size();
+    pthread_mutex_unlock(&lock);
+}
+
+// hands out the newest migrants that arrived, at most maximum of them; the
+// older ones had their chance
+void tIsland::receive(vector<vector<unsigned char> > &genomes, int maximum)
+{
+    genomes.clear();
+    
+    pthread_mutex_lock(&lock);
+    while ((int)inbox.size() > maximum)
+    {
+        inbox.pop_front();
+        ++dropped;
+    }
+    
+    while (!inbox.empty())
+    {
+        genomes.push_back(vector<unsigned char>());
+        genomes.back().swap(inbox.front());
+        inbox.pop_front();
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+// sends what is still queued, as far as the next island takes it within
+// drainTimeout seconds, and shuts down
+void tIsland::stop(void)
+{
+    if (!running)
+    {
+        return;
+    }
+    
+    pthread_mutex_lock(&lock);
+    stopping = true;
+    stopDeadline = islandClock() + drainTimeout;
+    pthread_mutex_unlock(&lock);
+    
+    pthread_join(thread, NULL);
+    running = false;
+}
+
+void *tIsland::networkMain(void *arg)
+{
+    ((tIsland*)arg)->serve();
+    
+    return NULL;
+}
+
+void tIsland::serve(void)
+{
+    while (true)
+    {
+        bool done;
+        bool connected = (nextSocket >= 0) && !connecting;
+        
+        pthread_mutex_lock(&lock);
+        if (sending.empty() && !outbox.empty() && connected)
+        {
+            sending.swap(outbox.front());
+            outbox.pop_front();
+            sendingOffset = 0;
+        }
+        
+        done = stopping && (!connected || (sending.empty() && outbox.empty()) || islandClock() >= stopDeadline);
+        pthread_mutex_unlock(&lock);
+        
+        if (done)
+        {
+            break;
+        }
+        
+        // the next island may not be up yet, or may have restarted
+        if (nextSocket < 0 && islandClock() >= nextAttempt)
+        {
+            connectNext();
+            nextAttempt = islandClock() + 1.0;
+        }
+        
+        if (connecting && islandClock() >= connectDeadline)
+        {
+            closeNext();
+        }
+        
+        vector<struct pollfd> fds(2 + incoming.size());
+        
+        fds[0].fd = listenSocket;
+        fds[0].events = POLLIN;
+        fds[1].fd = (nextSocket >= 0 && (connecting || !sending.empty())) ? nextSocket : -1;
+        fds[1].events = POLLOUT;
+        
+        for (size_t i = 0; i < incoming.size(); ++i)
+        {
+            fds[2 + i].fd = incoming[i].socket;
+            fds[2 + i].events = POLLIN;
+        }
+        
+        for (size_t i = 0; i < fds.size(); ++i)
+        {
+            fds[i].revents = 0;
+        }
+        
+        if (poll(&fds[0], fds.size(), 100) <= 0)
+        {
+            continue;
+        }
+        
+        if (fds[0].revents & POLLIN)
+        {
+            int socket = accept(listenSocket, NULL, NULL);
+            
+            if (socket >= 0 && setNonBlocking(socket))
+            {
+                incoming.push_back(tIslandConnection());
+                incoming.back().socket = socket;
+            }
+            else if (socket >= 0)
+            {
+                close(socket);
+            }
+        }
+        
+        if (fds[1].revents & (POLLOUT | POLLERR | POLLHUP))
+        {
+            if (connecting ? !finishConnect() : !writeNext())
+            {
+                closeNext();
+            }
+        }
+        
+        for (size_t i = incoming.size(); i > 0; --i)
+        {
+            if ((fds[1 + i].revents & (POLLIN | POLLERR | POLLHUP)) && !readIncoming(incoming[i - 1]))
+            {
+                close(incoming[i - 1].socket);
+                incoming.erase(incoming.begin() + (i - 1));
+            }
+        }
+    }
+    
+    closeNext();
+    
+    pthread_mutex_lock(&lock);
+    while (!outbox.empty())
+    {
+        dropped += (int)tGenomeFile::getWord(&outbox.front()[16], 4);
+        outbox.pop_front();
+    }
+    pthread_mutex_unlock(&lock);
+    
+    for (size_t i = 0; i < incoming.size(); ++i)
+    {
+        close(incoming[i].socket);
+    }
+    
+    incoming.clear();
+    close(listenSocket);
+    listenSocket = -1;
+}
+
+// starts connecting to the next island; poll reports when that is done
+void tIsland::connectNext(void)
+{
+    int socket = ::socket(AF_INET, SOCK_STREAM, 0);
+    
+    if (socket < 0)
+    {
+        return;
+    }
+    
+    if (!setNonBlocking(socket))
+    {
+        close(socket);
+        return;
+    }
+    
+    if (connect(socket, (struct sockaddr*)&nextAddress, sizeof(nextAddress)) == 0)
+    {
+        nextSocket = socket;
+        connecting = false;
+    }
+    else if (errno == EINPROGRESS)
+    {
+        nextSocket = socket;
+        connecting = true;
+        connectDeadline = islandClock() + connectTimeout;
+    }
+    else
+    {
+        close(socket);
+    }
+}
+
+// true once a connection that was in progress has come up
+bool tIsland::finishConnect(void)
+{
+    int error = 0;
+    socklen_t length = sizeof(error);
+    
+    if (getsockopt(nextSocket, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0)
+    {
+        return false;
+    }
+    
+    connecting = false;
+    
+    return true;
+}
+
+// writes as much of the current message as the socket takes
+bool tIsland::writeNext(void)
+{
+    while (sendingOffset < sending.size())
+    {
+        ssize_t written = write(nextSocket, &sending[sendingOffset], sending.size() - sendingOffset);
+        
+        if (written < 0)
+        {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        
+        sendingOffset += (size_t)written;
+    }
+    
+    sending.clear();
+    
+    return true;
+}
+
+// a message half sent when the connection broke is lost; the next connection starts afresh
+void tIsland::closeNext(void)
+{
+    if (nextSocket >= 0)
+    {
+        close(nextSocket);
+        nextSocket = -1;
+    }
+    
+    connecting = false;
+    
+    if (!sending.empty())
+    {
+        pthread_mutex_lock(&lock);
+        dropped += (int)tGenomeFile::getWord(&sending[16], 4);
+        pthread_mutex_unlock(&lock);
+        sending.clear();
+    }
+}
+
+// reads whatever has arrived on the connection and takes the messages that
+// are complete; false if the connection is closed or the stream makes no sense
+bool tIsland::readIncoming(tIslandConnection &connection)
+{
+    unsigned char chunk[65536];
+    
+    while (true)
+    {
+        ssize_t length = read(connection.socket, chunk, sizeof(chunk));
+        
+        if (length > 0)
+        {
+            connection.buffer.insert(connection.buffer.end(), chunk, chunk + length);
+            continue;
+        }
+        
+        if (length < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        
+        if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return takeMessages(connection);
+        }
+        
+        // closed, or broken; what is complete still counts
+        takeMessages(connection);
+        return false;
+    }
+}
+
+// moves every complete message at the start of the buffer to the inbox
+bool tIsland::takeMessages(tIslandConnection &connection)
+{
+    vector<unsigned char> &buffer = connection.buffer;
+    vector<vector<unsigned char> > genomes;
+    size_t begin = 0, length;
+    int result;
+    
+    while ((result = decodeMessage(buffer.empty() ? NULL : &buffer[0] + begin, buffer.size() - begin, length, genomes)) > 0)
+    {
+        pthread_mutex_lock(&lock);
+        for (size_t i = 0; i < genomes.size(); ++i)
+        {
+            // an empty genome could not make an agent
+            if (!genomes[i].empty())
+            {
+                inbox.push_back(vector<unsigned char>());
+                inbox.back().swap(genomes[i]);
+                ++received;
+            }
+        }
+        
+        while (inbox.size() > maxInboxGenomes)
+        {
+            inbox.pop_front();
+            ++dropped;
+        }
+        pthread_mutex_unlock(&lock);
+        
+        begin += length;
+    }
+    
+    buffer.erase(buffer.begin(), buffer.begin() + begin);
+    
+    return result == 0;
+}
+
+// one message with the migrants of a generation
+void tIsland::encodeMessage(int sender, int generation, const vector<vector<unsigned char> > &genomes, vector<unsigned char> &message)
+{
+    size_t position = migrationHeaderSize;
+    
+    for (size_t i = 0; i < genomes.size(); ++i)
+    {
+        position += migrationRecordSize + genomes[i].size();
+    }
+    
+    message.resize(position);
+    memcpy(&message[0], migrationMagic, 8);
+    tGenomeFile::putWord(&message[8], (uint64_t)sender, 4);
+    tGenomeFile::putWord(&message[12], (uint64_t)generation, 4);
+    tGenomeFile::putWord(&message[16], (uint64_t)genomes.size(), 4);
+    position = migrationHeaderSize;
+    
+    for (size_t i = 0; i < genomes.size(); ++i)
+    {
+        const unsigned char *bytes = genomes[i].empty() ? NULL : &genomes[i][0];
+        
+        tGenomeFile::putWord(&message[position], (uint64_t)genomes[i].size(), 4);
+        tGenomeFile::putWord(&message[position + 4], tGenomeFile::checksum(bytes, genomes[i].size()), 8);
+        
+        if (bytes != NULL)
+        {
+            memcpy(&message[position + migrationRecordSize], bytes, genomes[i].size());
+        }
+        
+        position += migrationRecordSize + genomes[i].size();
+    }
+}
+
+// takes the message at the start of the given bytes apart. 1 if it is all
+// there, with its length in length; 0 if more has to arrive first; -1 if the
+// bytes are no message or a genome does not match its checksum
+int tIsland::decodeMessage(const unsigned char *bytes, size_t size, size_t &length, vector<vector<unsigned char> > &genomes)
+{
+    genomes.clear();
+    
+    if (size < migrationHeaderSize)
+    {
+        return 0;
+    }
+    
+    if (memcmp(bytes, migrationMagic, 8) != 0 || tGenomeFile::getWord(bytes + 16, 4) > maxMigrantsPerMessage)
+    {
+        return -1;
+    }
+    
+    int count = (int)tGenomeFile::getWord(bytes + 16, 4);
+    size_t position = migrationHeaderSize;
+    
+    // find the end of the message before anything is copied
+    for (int i = 0; i < count; ++i)
+    {
+        if (size - position < migrationRecordSize)
+        {
+            return 0;
+        }
+        
+        uint64_t genomeLength = tGenomeFile::getWord(bytes + position, 4);
+        
+        if (genomeLength > maxMigrantLength)
+        {
+            return -1;
+        }
+        
+        if (size - position - migrationRecordSize < genomeLength)
+        {
+            return 0;
+        }
+        
+        position += migrationRecordSize + (size_t)genomeLength;
+    }
+    
+    length = position;
+    genomes.resize(count);
+    position = migrationHeaderSize;
+    
+    for (int i = 0; i < count; ++i)
+    {
+        size_t genomeLength = (size_t)tGenomeFile::getWord(bytes + position, 4);
+        const unsigned char *genome = bytes + position + migrationRecordSize;
+        
+        if (tGenomeFile::checksum(genomeLength > 0 ? genome : NULL, genomeLength) != tGenomeFile::getWord(bytes + position + 4, 8))
+        {
+            genomes.clear();
+            return -1;
+        }
+        
+        genomes[i].assign(genome, genome + genomeLength);
+        position += migrationRecordSize + genomeLength;
+    }
+    
+    return 1;
+}
@@ -0,0 +1,98 @@
+/*
+ * tIsland.h
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _tIsland_h_included_
+#define _tIsland_h_included_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <netinet/in.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// a connection from the previous island and the part of a message that has
+// come in on it so far
+class tIslandConnection{
+public:
+	int socket;
+	vector<unsigned char> buffer;
+};
+
+// one population of an island model run, which may be spread over several
+// processes and machines. the islands form a ring: every island listens on
+// its own address and sends its migrants to the next island of the list.
+// all network traffic is done by a thread of its own, so sending and
+// receiving never hold up the evolution; migrants that arrive in the meantime
+// are picked up at the next migration. that thread never blocks either: every
+// socket is non-blocking, messages are put together from whatever has arrived,
+// and connecting to the next island is polled like everything else.
+//
+// a message carries the migrants of one generation as binary genomes: magic,
+// sender, generation and count, then for every genome its length, checksum
+// and bytes. numbers are big endian, so any two machines understand each other.
+class tIsland{
+public:
+	int index;
+	// genomes sent, received, and lost on the way (or not taken in time)
+	int sent, received, dropped;
+
+	tIsland();
+	~tIsland();
+	static bool parsePeers(const char *list, vector<string> &peers);
+	bool start(int islandIndex, const vector<string> &peers);
+	void send(int generation, const vector<vector<unsigned char> > &genomes);
+	void receive(vector<vector<unsigned char> > &genomes, int maximum);
+	void stop(void);
+	static void encodeMessage(int sender, int generation, const vector<vector<unsigned char> > &genomes, vector<unsigned char> &message);
+	static int decodeMessage(const unsigned char *bytes, size_t size, size_t &length, vector<vector<unsigned char> > &genomes);
+
+private:
+	pthread_t thread;
+	pthread_mutex_t lock;
+	bool running, stopping;
+	double stopDeadline;
+	int listenSocket, nextSocket;
+	bool connecting;
+	struct sockaddr_in nextAddress;
+	double nextAttempt, connectDeadline;
+	vector<tIslandConnection> incoming;
+	deque<vector<unsigned char> > outbox;
+	deque<vector<unsigned char> > inbox;
+	vector<unsigned char> sending;
+	size_t sendingOffset;
+
+	static void *networkMain(void *arg);
+	void serve(void);
+	void connectNext(void);
+	bool finishConnect(void);
+	bool writeNext(void);
+	bool readIncoming(tIslandConnection &connection);
+	bool takeMessages(tIslandConnection &connection);
+	void closeNext(void);
+
+	tIsland(const tIsland &);
+	tIsland &operator=(const tIsland &);
+};
+
+#endif
@@ -0,0 +1,418 @@
+/*
+ * tPhylogeny.cpp
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tPhylogeny.h"
+#include "tGenomeFile.h"
+#include <algorithm>
+#include <unistd.h>
+
+tPhylogeny::tPhylogeny()
+{
+	root = -1;
+	lineageFile = NULL;
+}
+
+tPhylogeny::~tPhylogeny()
+{
+	if (lineageFile != NULL)
+	{
+		fclose(lineageFile);
+	}
+}
+
+// records of the line of descent are appended to this file as they become fixed
+void tPhylogeny::openLineageFile(const char *filename)
+{
+	lineageFile = fopen(filename, "w");
+}
+
+// continues a lineage file from a checkpoint: whatever was written after the
+// checkpoint was taken is cut off, since the resumed run writes it again
+void tPhylogeny::reopenLineageFile(const char *filename, long length)
+{
+	if (truncate(filename, (off_t)length) != 0)
+	{
+		lineageFile = fopen(filename, "w");
+		return;
+	}
+
+	lineageFile = fopen(filename, "a");
+}
+
+// bytes written to the lineage file so far
+long tPhylogeny::lineageLength(void)
+{
+	if (lineageFile == NULL)
+	{
+		return 0;
+	}
+
+	fflush(lineageFile);
+
+	return ftell(lineageFile);
+}
+
+// the agent everything else descends from
+int tPhylogeny::addRoot(const vector<unsigned char> &genome, int ID, int born)
+{
+	int node = newNode();
+
+	nodes[node].ID = ID;
+	nodes[node].born = born;
+	nodes[node].genomeSize = (int)genome.size();
+	root = node;
+	rootGenome = genome;
+
+	return node;
+}
+
+int tPhylogeny::addChild(int parent, const tGenomeDelta &delta, int ID, int born, int genomeSize)
+{
+	int node = newNode();
+	tPhylogenyNode &child = nodes[node];
+
+	child.parent = parent;
+	child.ID = ID;
+	child.born = born;
+	child.genomeSize = genomeSize;
+	child.delta = delta;
+
+	tPhylogenyNode &p = nodes[parent];
+
+	child.nextSibling = p.firstChild;
+	if (p.firstChild >= 0)
+	{
+		nodes[p.firstChild].previousSibling = node;
+	}
+	p.firstChild = node;
+	++p.refs;
+	++p.nrOfOffspring;
+
+	return node;
+}
+
+// a migrant, whose delta replaces the whole genome
+int tPhylogeny::addImmigrant(const tGenomeDelta &delta, int ID, int born, int genomeSize)
+{
+	int node = newNode();
+	tPhylogenyNode &n = nodes[node];
+
+	n.immigrant = true;
+	n.ID = ID;
+	n.born = born;
+	n.genomeSize = genomeSize;
+	n.delta = delta;
+	immigrants.push_back(node);
+
+	return node;
+}
+
+void tPhylogeny::setFitness(int node, double fitness)
+{
+	nodes[node].fitness = fitness;
+}
+
+// the agent of this node left the population
+void tPhylogeny::retire(int node)
+{
+	nodes[node].alive = false;
+	release(node);
+}
+
+// moves the root down as far as the whole tree runs through a single line,
+// writing the records of the nodes passed on the way
+void tPhylogeny::coalesce(void)
+{
+	bool wrote = false;
+
+	// the migrants' trees are shortened the same way, only their records are
+	// passed down instead of written
+	for (int i = 0; i < (int)immigrants.size(); ++i)
+	{
+		int top = immigrants[i];
+
+		while (!nodes[top].alive && (nodes[top].refs == 1))
+		{
+			int child = nodes[top].firstChild;
+			vector<unsigned char> genome;
+
+			nodes[top].delta.apply(genome);
+			nodes[child].delta.apply(genome);
+			nodes[child].delta.clear();
+			nodes[child].delta.replacement.swap(genome);
+			nodes[child].pending.swap(nodes[top].pending);
+			appendRecord(top, nodes[child].pending);
+			nodes[child].parent = -1;
+			freeNode(top);
+			top = child;
+		}
+
+		immigrants[i] = top;
+	}
+
+	if ((root < 0) && (immigrants.size() == 1))
+	{
+		root = immigrants[0];
+		immigrants.clear();
+		rootGenome.clear();
+		nodes[root].delta.apply(rootGenome);
+		nodes[root].delta.clear();
+	}
+
+	while ((root >= 0) && !nodes[root].alive && (nodes[root].refs == 1))
+	{
+		int child = nodes[root].firstChild;
+
+		writeRecord(root);
+		wrote = true;
+
+		nodes[child].delta.apply(rootGenome);
+		nodes[child].delta.clear();
+		nodes[child].parent = -1;
+		freeNode(root);
+		root = child;
+	}
+
+	if (wrote && (lineageFile != NULL))
+	{
+		fflush(lineageFile);
+	}
+}
+
+// the node the given number of generations up the line, or where the line
+// starts if it does not reach back that far: the root or a migrant
+int tPhylogeny::getAncestor(int node, int generations)
+{
+	while ((generations > 0) && (nodes[node].parent >= 0))
+	{
+		node = nodes[node].parent;
+		--generations;
+	}
+
+	return node;
+}
+
+void tPhylogeny::rebuildGenome(int node, vector<unsigned char> &genome)
+{
+	vector<int> line;
+
+	for (; (node != root) && (nodes[node].parent >= 0); node = nodes[node].parent)
+	{
+		line.push_back(node);
+	}
+
+	// the top of a migrant's tree replaces whatever it is applied to
+	if (node == root)
+	{
+		genome = rootGenome;
+	}
+	else
+	{
+		line.push_back(node);
+		genome.clear();
+	}
+
+	for (int i = (int)line.size() - 1; i >= 0; --i)
+	{
+		nodes[line[i]].delta.apply(genome);
+	}
+}
+
+void tPhylogeny::saveGenome(int node, const char *filename)
+{
+	vector<unsigned char> genome;
+
+	rebuildGenome(node, genome);
+	tGenomeFile::saveText(filename, genome.empty() ? NULL : &genome[0], genome.size());
+}
+
+void tPhylogeny::saveState(tCheckpoint &checkpoint)
+{
+	checkpoint.putInt((int)nodes.size());
+
+	for (int i = 0; i < (int)nodes.size(); ++i)
+	{
+		tPhylogenyNode &n = nodes[i];
+
+		checkpoint.putInt(n.parent);
+		checkpoint.putInt(n.firstChild);
+		checkpoint.putInt(n.nextSibling);
+		checkpoint.putInt(n.previousSibling);
+		checkpoint.putInt(n.refs);
+		checkpoint.putInt(n.alive ? 1 : 0);
+		checkpoint.putInt(n.immigrant ? 1 : 0);
+		checkpoint.putInt(n.ID);
+		checkpoint.putInt(n.born);
+		checkpoint.putInt(n.genomeSize);
+		checkpoint.putInt(n.nrOfOffspring);
+		checkpoint.putDouble(n.fitness);
+		n.delta.saveState(checkpoint);
+		checkpoint.putString(n.pending);
+	}
+
+	checkpoint.putIntVector(freeNodes);
+	checkpoint.putInt(root);
+	checkpoint.putIntVector(immigrants);
+	checkpoint.putByteVector(rootGenome);
+}
+
+void tPhylogeny::loadState(tCheckpoint &checkpoint)
+{
+	int size = checkpoint.getInt();
+
+	nodes.clear();
+
+	if (checkpoint.failed || size < 0)
+	{
+		return;
+	}
+
+	nodes.resize(size);
+
+	for (int i = 0; i < size && !checkpoint.failed; ++i)
+	{
+		tPhylogenyNode &n = nodes[i];
+
+		n.parent = checkpoint.getInt();
+		n.firstChild = checkpoint.getInt();
+		n.nextSibling = checkpoint.getInt();
+		n.previousSibling = checkpoint.getInt();
+		n.refs = checkpoint.getInt();
+		n.alive = checkpoint.getInt() != 0;
+		n.immigrant = checkpoint.getInt() != 0;
+		n.ID = checkpoint.getInt();
+		n.born = checkpoint.getInt();
+		n.genomeSize = checkpoint.getInt();
+		n.nrOfOffspring = checkpoint.getInt();
+		n.fitness = checkpoint.getDouble();
+		n.delta.loadState(checkpoint);
+		n.pending = checkpoint.getString();
+	}
+
+	checkpoint.getIntVector(freeNodes);
+	root = checkpoint.getInt();
+	checkpoint.getIntVector(immigrants);
+	checkpoint.getByteVector(rootGenome);
+}
+
+int tPhylogeny::newNode(void)
+{
+	int node;
+
+	if (freeNodes.empty())
+	{
+		node = (int)nodes.size();
+		nodes.resize(nodes.size() + 1);
+	}
+	else
+	{
+		node = freeNodes.back();
+		freeNodes.pop_back();
+	}
+
+	tPhylogenyNode &n = nodes[node];
+
+	n.parent = -1;
+	n.firstChild = -1;
+	n.nextSibling = -1;
+	n.previousSibling = -1;
+	n.refs = 1;
+	n.alive = true;
+	n.immigrant = false;
+	n.nrOfOffspring = 0;
+	n.fitness = 0.0;
+	n.delta.clear();
+	n.pending.clear();
+
+	return node;
+}
+
+void tPhylogeny::freeNode(int node)
+{
+	freeNodes.push_back(node);
+}
+
+// drops one reference to node; nodes without any left are unlinked and freed,
+// which in turn drops the reference they held on their parent. a loop rather
+// than recursion, since a dying branch can be long
+void tPhylogeny::release(int node)
+{
+	while ((node >= 0) && (--nodes[node].refs == 0))
+	{
+		tPhylogenyNode &n = nodes[node];
+		int parent = n.parent;
+
+		if (n.previousSibling >= 0)
+		{
+			nodes[n.previousSibling].nextSibling = n.nextSibling;
+		}
+		else if (parent >= 0)
+		{
+			nodes[parent].firstChild = n.nextSibling;
+		}
+
+		if (n.nextSibling >= 0)
+		{
+			nodes[n.nextSibling].previousSibling = n.previousSibling;
+		}
+
+		if (node == root)
+		{
+			root = -1;
+		}
+		else if (parent < 0)
+		{
+			immigrants.erase(find(immigrants.begin(), immigrants.end(), node));
+		}
+
+		freeNode(node);
+		node = parent;
+	}
+}
+
+// the record of one node, after the mark of a break in the line of descent if
+// a migrant took over there; what came before is not its ancestry
+void tPhylogeny::appendRecord(int node, string &records)
+{
+	tPhylogenyNode &n = nodes[node];
+	char line[128];
+
+	if (n.immigrant)
+	{
+		records += "# migrant\n";
+	}
+
+	snprintf(line, sizeof(line), "%i	%i	%i	%f	%i\n", n.ID, n.born, n.genomeSize, n.fitness, n.nrOfOffspring);
+	records += line;
+}
+
+void tPhylogeny::writeRecord(int node)
+{
+	if (lineageFile == NULL)
+	{
+		return;
+	}
+
+	string records = nodes[node].pending;
+
+	appendRecord(node, records);
+	fputs(records.c_str(), lineageFile);
+}
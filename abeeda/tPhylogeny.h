@@ -0,0 +1,104 @@
+/*
+ * tPhylogeny.h
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _tPhylogeny_h_included_
+#define _tPhylogeny_h_included_
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "tGenomeDelta.h"
+#include "tCheckpoint.h"
+
+using namespace std;
+
+// one agent of the tree. refs counts the node's children plus one while the
+// agent is still alive; the children of a node form a doubly linked list.
+class tPhylogenyNode{
+public:
+	int parent, firstChild, nextSibling, previousSibling;
+	int refs;
+	bool alive;
+	// came from another island. such a node does not descend from the root
+	// and starts a tree of its own
+	bool immigrant;
+	int ID, born, genomeSize, nrOfOffspring;
+	double fitness;
+	// the edits that made this agent's genome from its parent's
+	tGenomeDelta delta;
+	// lineage records of the line above the top of a migrant's tree, kept
+	// until it is known whether they belong to the line of descent
+	string pending;
+};
+
+// the ancestry of the living population, kept apart from the agents so those
+// can be overwritten as soon as their generation is over. nodes live in an arena
+// and refer to each other by index.
+//
+// a node is pruned as soon as it is dead and has no descendants left. the
+// root is the most recent common ancestor of everything still in the tree:
+// whenever the root is dead and has a single child, that child becomes the
+// root and the old root's record is written out, since no later event can
+// change it. only the root keeps a full genome; every other genome is rebuilt
+// from it by replaying the deltas on the way down.
+//
+// migrants from other islands have no ancestor here. each starts a tree of its
+// own next to the root's, so that they never hold up the root's coalescence;
+// their trees are shortened the same way, with the top's genome as a delta
+// that replaces the whole genome. when the root's tree has died out and a
+// single migrant's tree is left, its top becomes the new root. the lineage
+// file marks that break: the records before it end in a line that died out.
+class tPhylogeny{
+public:
+	vector<tPhylogenyNode> nodes;
+	vector<int> freeNodes;
+	int root;
+	// the tops of the migrants' trees
+	vector<int> immigrants;
+	vector<unsigned char> rootGenome;
+	FILE *lineageFile;
+
+	tPhylogeny();
+	~tPhylogeny();
+	void openLineageFile(const char *filename);
+	void reopenLineageFile(const char *filename, long length);
+	long lineageLength(void);
+	int addRoot(const vector<unsigned char> &genome, int ID, int born);
+	int addChild(int parent, const tGenomeDelta &delta, int ID, int born, int genomeSize);
+	int addImmigrant(const tGenomeDelta &delta, int ID, int born, int genomeSize);
+	void setFitness(int node, double fitness);
+	void retire(int node);
+	void coalesce(void);
+	int getAncestor(int node, int generations);
+	void rebuildGenome(int node, vector<unsigned char> &genome);
+	void saveGenome(int node, const char *filename);
+	void saveState(tCheckpoint &checkpoint);
+	void loadState(tCheckpoint &checkpoint);
+
+private:
+	int newNode(void);
+	void freeNode(int node);
+	void release(int node);
+	void appendRecord(int node, string &records);
+	void writeRecord(int node);
+};
+
+#endif
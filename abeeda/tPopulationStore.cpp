@@ -0,0 +1,112 @@
+/*
+ * tPopulationStore.cpp
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tPopulationStore.h"
+
+// threads that are not running hold nothing and never delay a reclaim
+#define storeOffline (~(uint64_t)0)
+
+tPopulationStore::tPopulationStore(int size, int nrThreads)
+{
+	slots.resize(size, (tAgent*)NULL);
+	epoch = 1;
+	threads.resize(nrThreads);
+
+	for (int i = 0; i < nrThreads; ++i)
+	{
+		threads[i].seen = storeOffline;
+	}
+}
+
+// the sequentially consistent accesses to slots and to seen are what makes
+// the reclamation safe: a thread that a reclaim saw offline cannot read a slot
+// before the replacement that retired the agent
+tAgent *tPopulationStore::get(int slot)
+{
+	return __atomic_load_n(&slots[slot], __ATOMIC_SEQ_CST);
+}
+
+// only for filling the store before any thread runs
+void tPopulationStore::set(int slot, tAgent *agent)
+{
+	__atomic_store_n(&slots[slot], agent, __ATOMIC_SEQ_CST);
+}
+
+bool tPopulationStore::replace(int slot, tAgent *expected, tAgent *agent)
+{
+	return __atomic_compare_exchange_n(&slots[slot], &expected, agent, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+void tPopulationStore::online(int thread)
+{
+	__atomic_store_n(&threads[thread].seen, __atomic_load_n(&epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+}
+
+void tPopulationStore::offline(int thread)
+{
+	__atomic_store_n(&threads[thread].seen, storeOffline, __ATOMIC_SEQ_CST);
+}
+
+void tPopulationStore::quiescent(int thread)
+{
+	__atomic_store_n(&threads[thread].seen, __atomic_load_n(&epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+}
+
+void tPopulationStore::retire(int thread, tAgent *agent)
+{
+	threads[thread].limbo.push_back(agent);
+	threads[thread].limboEpochs.push_back(__atomic_add_fetch(&epoch, 1, __ATOMIC_SEQ_CST));
+}
+
+// moves the agents this thread retired that nobody can see anymore to safe
+void tPopulationStore::reclaim(int thread, vector<tAgent*> &safe)
+{
+	tStoreThread &self = threads[thread];
+	uint64_t oldest = storeOffline;
+	size_t kept = 0;
+
+	for (size_t i = 0; i < threads.size(); ++i)
+	{
+		uint64_t seen = __atomic_load_n(&threads[i].seen, __ATOMIC_SEQ_CST);
+
+		if (seen < oldest)
+		{
+			oldest = seen;
+		}
+	}
+
+	for (size_t i = 0; i < self.limbo.size(); ++i)
+	{
+		if (self.limboEpochs[i] <= oldest)
+		{
+			safe.push_back(self.limbo[i]);
+		}
+		else
+		{
+			self.limbo[kept] = self.limbo[i];
+			self.limboEpochs[kept] = self.limboEpochs[i];
+			++kept;
+		}
+	}
+
+	self.limbo.resize(kept);
+	self.limboEpochs.resize(kept);
+}
@@ -0,0 +1,70 @@
+/*
+ * tPopulationStore.h
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _tPopulationStore_h_included_
+#define _tPopulationStore_h_included_
+
+#include <stdint.h>
+#include <vector>
+#include "tAgent.h"
+
+using namespace std;
+
+// per thread bookkeeping, padded so that no two threads share a cache line
+class tStoreThread{
+public:
+	uint64_t seen;
+	vector<tAgent*> limbo;
+	vector<uint64_t> limboEpochs;
+	char padding[64];
+};
+
+// the population of the steady state mode: one slot per member, read and
+// replaced by all threads at once without a lock. a slot only ever changes by
+// compare-and-swap from the agent a thread looked at to its replacement, so
+// two threads cannot both replace the same agent.
+//
+// a replaced agent may still be read by threads that picked it before it was
+// replaced, so it is not reused right away (quiescent state based
+// reclamation). every thread calls quiescent() whenever it holds no pointer
+// taken from the store; an agent retired in epoch e is safe once every
+// online thread has passed a quiescent state at or after e.
+class tPopulationStore{
+public:
+	tPopulationStore(int size, int nrThreads);
+	int size(void) const { return (int)slots.size(); }
+	tAgent *get(int slot);
+	void set(int slot, tAgent *agent);
+	bool replace(int slot, tAgent *expected, tAgent *agent);
+
+	void online(int thread);
+	void offline(int thread);
+	void quiescent(int thread);
+	void retire(int thread, tAgent *agent);
+	void reclaim(int thread, vector<tAgent*> &safe);
+
+private:
+	vector<tAgent*> slots;
+	uint64_t epoch;
+	vector<tStoreThread> threads;
+};
+
+#endif
@@ -0,0 +1,69 @@
+/*
+ * tRandom.cpp
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tRandom.h"
+
+// splitmix64 step; used to spread seeds and keys over the whole generator state
+static uint64_t splitMix(uint64_t &x)
+{
+    uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+tRandom::tRandom()
+{
+    seed(0);
+}
+
+tRandom::tRandom(uint64_t seed)
+{
+    this->seed(seed);
+}
+
+void tRandom::seed(uint64_t seed)
+{
+    uint64_t x = seed;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        s[i] = splitMix(x);
+    }
+
+    bitBuffer = 0;
+    bitsLeft = 0;
+}
+
+// derives an independent stream from the run seed and a (purpose, generation, index) key
+tRandom tRandom::stream(uint64_t runSeed, int purpose, uint64_t generation, uint64_t index)
+{
+    uint64_t x = runSeed;
+    uint64_t key = splitMix(x);
+
+    x = key ^ (uint64_t)purpose;
+    key = splitMix(x);
+    x = key ^ generation;
+    key = splitMix(x);
+    x = key ^ index;
+
+    return tRandom(splitMix(x));
+}
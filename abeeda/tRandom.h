@@ -0,0 +1,129 @@
+/*
+ * tRandom.h
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _tRandom_h_included_
+#define _tRandom_h_included_
+
+#include <stdint.h>
+#include <math.h>
+
+// what a stream is used for; part of the key a stream is derived from
+enum tRandomPurpose{
+    RNG_SETUP = 1,
+    RNG_EVALUATION = 2,
+    RNG_REPRODUCTION = 3,
+    // offspring number e of the steady state mode: index 0 breeds, 1 evaluates
+    RNG_STEADY_STATE = 4,
+    RNG_MIGRATION = 5
+};
+
+// xoshiro256** generator. every stream is derived from the run seed plus a key
+// (purpose, generation, index), so the numbers an agent sees do not depend on
+// how many other streams were used before it or on which thread uses it.
+class tRandom{
+public:
+    uint64_t s[4];
+    uint64_t bitBuffer;
+    int bitsLeft;
+
+    tRandom();
+    tRandom(uint64_t seed);
+    void seed(uint64_t seed);
+    static tRandom stream(uint64_t runSeed, int purpose, uint64_t generation, uint64_t index);
+
+    inline uint64_t next(void)
+    {
+        const uint64_t result = rotl(s[1] * 5, 7) * 9;
+        const uint64_t t = s[1] << 17;
+
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+
+        return result;
+    }
+
+    // uniform integer in [0, n)
+    inline unsigned int nextInt(unsigned int n)
+    {
+        uint64_t m = (next() >> 32) * (uint64_t)n;
+
+        if ((uint32_t)m < n)
+        {
+            uint32_t threshold = (uint32_t)(-n) % n;
+
+            while ((uint32_t)m < threshold)
+            {
+                m = (next() >> 32) * (uint64_t)n;
+            }
+        }
+
+        return (unsigned int)(m >> 32);
+    }
+
+    // uniform double in [0, 1)
+    inline double nextDouble(void)
+    {
+        return (double)(next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // the next nrBits (<= 32) bits, handed out from a buffered 64-bit word
+    inline unsigned int nextBits(int nrBits)
+    {
+        if (bitsLeft < nrBits)
+        {
+            bitBuffer = next();
+            bitsLeft = 64;
+        }
+
+        unsigned int result = (unsigned int)(bitBuffer & ((1ULL << nrBits) - 1));
+        bitBuffer >>= nrBits;
+        bitsLeft -= nrBits;
+
+        return result;
+    }
+
+    // number of failures before the first success in a row of independent trials
+    // that each fail with probability exp(logFailure); anything from limit on is
+    // returned as limit
+    inline unsigned int nextGeometric(double logFailure, unsigned int limit)
+    {
+        if (logFailure >= 0.0)
+        {
+            return limit;
+        }
+
+        const double skip = log(1.0 - nextDouble()) / logFailure;
+
+        return (skip < (double)limit) ? (unsigned int)skip : limit;
+    }
+
+private:
+    static inline uint64_t rotl(const uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+};
+
+#endif
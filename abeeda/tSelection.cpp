@@ -0,0 +1,220 @@
+/*
+ * tSelection.cpp
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <algorithm>
+#include "tSelection.h"
+
+tSelection::tSelection()
+{
+	method = SELECTION_ROULETTE;
+	tournamentSize = 2;
+	truncationFraction = 0.5;
+	totalFitness = 0.0;
+	dominant = -1;
+}
+
+void tSelection::prepare(const vector<double> &fitnesses)
+{
+	int n = (int)fitnesses.size();
+
+	fitness = fitnesses;
+	totalFitness = 0.0;
+
+	for (int i = 0; i < n; ++i)
+	{
+		if (!(fitness[i] > 0.0))
+		{
+			fitness[i] = 0.0;
+		}
+
+		totalFitness += fitness[i];
+	}
+
+	if (method == SELECTION_ROULETTE)
+	{
+		dominant = -1;
+
+		for (int i = 0; i < n; ++i)
+		{
+			if (fitness[i] > 0.5 * totalFitness)
+			{
+				dominant = i;
+			}
+		}
+
+		buildAliasTable(-1, probability, alias);
+
+		if (dominant >= 0)
+		{
+			buildAliasTable(dominant, probabilityWithout, aliasWithout);
+		}
+	}
+	else if (method == SELECTION_TRUNCATION)
+	{
+		int kept = (int)ceil(truncationFraction * (double)n);
+		tFitterFirst fitterFirst;
+
+		kept = max(kept, 2);
+		kept = min(kept, n);
+
+		best.resize(n);
+
+		for (int i = 0; i < n; ++i)
+		{
+			best[i] = i;
+		}
+
+		fitterFirst.fitness = &fitness;
+		nth_element(best.begin(), best.begin() + (kept - 1), best.end(), fitterFirst);
+		best.resize(kept);
+		sort(best.begin(), best.end());
+	}
+}
+
+// Vose's construction: every column k of the table is hit with probability
+// 1/n and then keeps k with probabilities[k], otherwise gives aliases[k]. the
+// agent left (if any) is given no weight.
+void tSelection::buildAliasTable(int left, vector<double> &probabilities, vector<int> &aliases)
+{
+	int n = (int)fitness.size();
+	double total = totalFitness - ((left >= 0) ? fitness[left] : 0.0);
+
+	probabilities.resize(n);
+	aliases.resize(n);
+	small.clear();
+	large.clear();
+
+	for (int i = 0; i < n; ++i)
+	{
+		if (total > 0.0)
+		{
+			probabilities[i] = (i == left) ? 0.0 : fitness[i] * (double)n / total;
+		}
+		else
+		{
+			probabilities[i] = (i == left) ? 0.0 : (double)n / (double)(n - ((left >= 0) ? 1 : 0));
+		}
+
+		aliases[i] = i;
+
+		if (probabilities[i] < 1.0)
+		{
+			small.push_back(i);
+		}
+		else
+		{
+			large.push_back(i);
+		}
+	}
+
+	while (!small.empty() && !large.empty())
+	{
+		int s = small.back();
+		int l = large.back();
+
+		small.pop_back();
+		large.pop_back();
+
+		aliases[s] = l;
+		probabilities[l] += probabilities[s] - 1.0;
+
+		if (probabilities[l] < 1.0)
+		{
+			small.push_back(l);
+		}
+		else
+		{
+			large.push_back(l);
+		}
+	}
+
+	// whatever is left over is 1 up to rounding
+	for (size_t i = 0; i < small.size(); ++i)
+	{
+		probabilities[small[i]] = 1.0;
+	}
+
+	for (size_t i = 0; i < large.size(); ++i)
+	{
+		probabilities[large[i]] = 1.0;
+	}
+}
+
+int tSelection::drawAlias(const vector<double> &probabilities, const vector<int> &aliases, tRandom &rng)
+{
+	int k = (int)rng.nextInt((unsigned int)probabilities.size());
+
+	return (rng.nextDouble() < probabilities[k]) ? k : aliases[k];
+}
+
+int tSelection::select(int exclude, tRandom &rng)
+{
+	int n = (int)fitness.size();
+	int j;
+
+	if (n < 2)
+	{
+		return 0;
+	}
+
+	if (method == SELECTION_TOURNAMENT)
+	{
+		j = drawOther(exclude, rng);
+
+		for (int t = 1; t < tournamentSize; ++t)
+		{
+			int challenger = drawOther(exclude, rng);
+
+			if (fitness[challenger] > fitness[j])
+			{
+				j = challenger;
+			}
+		}
+
+		return j;
+	}
+
+	if (method == SELECTION_TRUNCATION)
+	{
+		do
+		{
+			j = best[rng.nextInt((unsigned int)best.size())];
+		} while (j == exclude);
+
+		return j;
+	}
+
+	do
+	{
+		j = (exclude == dominant) ? drawAlias(probabilityWithout, aliasWithout, rng) : drawAlias(probability, alias, rng);
+	} while (j == exclude);
+
+	return j;
+}
+
+// uniform over everyone but exclude
+int tSelection::drawOther(int exclude, tRandom &rng)
+{
+	int j = (int)rng.nextInt((unsigned int)fitness.size() - 1);
+
+	return (j >= exclude) ? j + 1 : j;
+}
@@ -0,0 +1,88 @@
+/*
+ * tSelection.h
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _tSelection_h_included_
+#define _tSelection_h_included_
+
+#include <vector>
+#include "tRandom.h"
+
+using namespace std;
+
+enum tSelectionMethod{
+    SELECTION_ROULETTE = 0,
+    SELECTION_TOURNAMENT = 1,
+    SELECTION_TRUNCATION = 2
+};
+
+// orders agents best first; equal fitness goes by index so the outcome does
+// not depend on the sort
+class tFitterFirst{
+public:
+	const vector<double> *fitness;
+
+	bool operator()(int a, int b) const
+	{
+		if ((*fitness)[a] != (*fitness)[b])
+		{
+			return (*fitness)[a] > (*fitness)[b];
+		}
+
+		return a < b;
+	}
+};
+
+// picks the parents of the next generation. prepare() is called once per
+// generation with the fitnesses of the population; every select() after that
+// returns the index of a parent other than the offspring's own index.
+//
+// roulette: fitness proportional, through a Walker alias table, so a draw
+//   costs O(1) however skewed the fitnesses are. a draw of the excluded agent
+//   is redrawn; the one agent that may hold more than half of all fitness
+//   gets a second table without it, so that never takes more than two draws
+//   on average.
+// tournament: the fittest of tournamentSize agents drawn uniformly.
+// truncation: uniform among the best truncationFraction of the population.
+class tSelection{
+public:
+	int method;
+	int tournamentSize;
+	double truncationFraction;
+
+	tSelection();
+	void prepare(const vector<double> &fitnesses);
+	int select(int exclude, tRandom &rng);
+
+private:
+	vector<double> fitness;
+	double totalFitness;
+	vector<double> probability, probabilityWithout;
+	vector<int> alias, aliasWithout;
+	int dominant;
+	vector<int> best;
+	vector<int> small, large;
+
+	void buildAliasTable(int left, vector<double> &probabilities, vector<int> &aliases);
+	int drawAlias(const vector<double> &probabilities, const vector<int> &aliases, tRandom &rng);
+	int drawOther(int exclude, tRandom &rng);
+};
+
+#endif
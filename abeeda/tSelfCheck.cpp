@@ -0,0 +1,1475 @@
+/*
+ * tSelfCheck.cpp
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "tSelfCheck.h"
+#include "tAgent.h"
+#include "tCheckpoint.h"
+#include "tCodonScanner.h"
+#include "tGame.h"
+#include "tGenome.h"
+#include "tGenomeArchive.h"
+#include "tGenomeFile.h"
+#include "tIsland.h"
+#include "tPhylogeny.h"
+#include "tSelection.h"
+#include "tThreadPool.h"
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+struct tCheckContext{
+	vector<tAgent*> *agents;
+	tGame *game;
+};
+
+// plays a few games with one agent, the way the generation loop does
+static void playAgent(int index, int, void *context)
+{
+	tCheckContext *check = (tCheckContext*)context;
+	tAgent *agent = (*check->agents)[index];
+	double total = 0.0;
+
+	for (int j = 0; j < 10; ++j)
+	{
+		check->game->executeGame(agent, NULL, false);
+		total += agent->fitness;
+	}
+
+	agent->fitness = total / 10.0;
+}
+
+// the parsed gates and the node map; the kernels are compiled from these
+static bool sameGates(tAgent *a, tAgent *b)
+{
+	tGateList &x = a->info->gates, &y = b->info->gates;
+
+	return x.nrIns == y.nrIns && x.nrOuts == y.nrOuts
+		&& x.inStart == y.inStart && x.outStart == y.outStart
+		&& x.tableStart == y.tableStart && x.rowStart == y.rowStart
+		&& x.geneStart == y.geneStart && x.geneLength == y.geneLength
+		&& x.rawIns == y.rawIns && x.rawOuts == y.rawOuts
+		&& x.inNodes == y.inNodes && x.outNodes == y.outNodes
+		&& x.tables == y.tables && x.sums == y.sums
+		&& x.deterministic == y.deterministic
+		&& memcmp(a->info->nodeMap, b->info->nodeMap, sizeof(a->info->nodeMap)) == 0;
+}
+
+// a genome where half the bytes are start codon bytes, so that point
+// mutations keep making and breaking genes
+static void setupDenseAgent(tAgent *agent, int nucleotides)
+{
+	const unsigned char codonBytes[4] = { 42, 255 - 42, 41, 255 - 41 };
+	vector<unsigned char> &bytes = agent->editGenome();
+
+	bytes.resize(nucleotides);
+
+	for (int i = 0; i < nucleotides; ++i)
+	{
+		bytes[i] = (agent->rng.nextBits(1) == 0) ? codonBytes[agent->rng.nextBits(2)] : (unsigned char)agent->rng.nextBits(8);
+	}
+
+	agent->setupPhenotype();
+}
+
+// chi-square statistic of two binned samples coming from the same distribution;
+// bins are merged from the left until both samples expect at least 10 in them
+static double chiSquareTwoSample(const vector<double> &first, const vector<double> &second, int &degrees)
+{
+	double firstTotal = 0.0, secondTotal = 0.0, statistic = 0.0;
+	double r = 0.0, t = 0.0;
+	int i;
+
+	for (i = 0; i < (int)first.size(); ++i)
+	{
+		firstTotal += first[i];
+		secondTotal += second[i];
+	}
+
+	const double k1 = sqrt(secondTotal / firstTotal), k2 = sqrt(firstTotal / secondTotal);
+
+	degrees = -1;
+
+	for (i = 0; i < (int)first.size(); ++i)
+	{
+		r += first[i];
+		t += second[i];
+
+		const bool last = (i + 1 == (int)first.size());
+
+		if (((r + t) * firstTotal / (firstTotal + secondTotal) >= 10.0 && (r + t) * secondTotal / (firstTotal + secondTotal) >= 10.0) || (last && r + t > 0.0))
+		{
+			statistic += (k1 * r - k2 * t) * (k1 * r - k2 * t) / (r + t);
+			++degrees;
+			r = t = 0.0;
+		}
+	}
+
+	return statistic;
+}
+
+// the chi-square value a true hypothesis exceeds with probability about 1e-4
+// (Wilson-Hilferty approximation)
+static double chiSquareCritical(int degrees)
+{
+	const double z = 3.719, c = 2.0 / (9.0 * (double)degrees);
+
+	return (double)degrees * pow(1.0 - c + z * sqrt(c), 3.0);
+}
+
+// the parent selection as the plain code would do it: rejection sampling for
+// roulette, the fittest of a uniform draw for tournament, and a full sort for
+// truncation
+static int referenceSelect(const vector<double> &fitness, const tSelection &selection, int exclude, tRandom &rng)
+{
+	const int n = (int)fitness.size();
+	int j;
+
+	if (selection.method == SELECTION_TOURNAMENT)
+	{
+		do
+		{
+			j = (int)rng.nextInt(n);
+		} while (j == exclude);
+
+		for (int t = 1; t < selection.tournamentSize; ++t)
+		{
+			int challenger;
+
+			do
+			{
+				challenger = (int)rng.nextInt(n);
+			} while (challenger == exclude);
+
+			if (fitness[challenger] > fitness[j])
+			{
+				j = challenger;
+			}
+		}
+
+		return j;
+	}
+
+	if (selection.method == SELECTION_TRUNCATION)
+	{
+		vector<pair<double, int> > order(n);
+		int kept = (int)ceil(selection.truncationFraction * (double)n);
+
+		for (int i = 0; i < n; ++i)
+		{
+			order[i] = make_pair(-fitness[i], i);
+		}
+
+		sort(order.begin(), order.end());
+		kept = min(max(kept, 2), n);
+
+		do
+		{
+			j = order[rng.nextInt(kept)].second;
+		} while (j == exclude);
+
+		return j;
+	}
+
+	const double maxFitness = *max_element(fitness.begin(), fitness.end());
+
+	do
+	{
+		j = (int)rng.nextInt(n);
+	} while ((j == exclude) || (rng.nextDouble() > fitness[j] / maxFitness));
+
+	return j;
+}
+
+// evaluates the same population on one thread and on three
+bool tSelfCheck::threadCount(uint64_t seed)
+{
+	const int n = 50;
+	vector<tAgent*> agents(n);
+	vector<double> serial(n);
+	tGame game;
+	tCheckContext context;
+	bool ok = true;
+	int i, pass;
+
+	for (i = 0; i < n; ++i)
+	{
+		agents[i] = new tAgent;
+		agents[i]->rng = tRandom::stream(seed, RNG_SETUP, 0, i);
+		agents[i]->setupRandomAgent(5000);
+	}
+
+	context.agents = &agents;
+	context.game = &game;
+
+	for (pass = 0; pass < 2; ++pass)
+	{
+		tThreadPool pool((pass == 0) ? 1 : 3);
+
+		for (i = 0; i < n; ++i)
+		{
+			agents[i]->rng = tRandom::stream(seed, RNG_EVALUATION, 0, i);
+		}
+
+		pool.parallelFor(n, &playAgent, &context);
+
+		for (i = 0; i < n; ++i)
+		{
+			if (pass == 0)
+			{
+				serial[i] = agents[i]->fitness;
+			}
+			else if (agents[i]->fitness != serial[i])
+			{
+				cerr << "agent " << i << " scored " << serial[i] << " on one thread and " << agents[i]->fitness << " on three." << endl;
+				ok = false;
+			}
+		}
+	}
+
+	for (i = 0; i < n; ++i)
+	{
+		delete agents[i];
+	}
+
+	return ok;
+}
+
+struct tStealContext{
+	vector<int> runs, runner;
+	int slow;
+};
+
+// the items of the first block take a while, all others return at once
+static void stealItem(int index, int thread, void *context)
+{
+	tStealContext *check = (tStealContext*)context;
+
+	__sync_fetch_and_add(&check->runs[index], 1);
+	check->runner[index] = thread;
+
+	if (index < check->slow)
+	{
+		usleep(2000);
+	}
+}
+
+// with equal costs but one slow block, the other threads have to take work
+// off the thread that holds it. every item runs once, and the pool counts as
+// stolen exactly the items that ran outside the block they were seeded to
+bool tSelfCheck::workStealing(int items)
+{
+	const int nrThreads = 4;
+	tThreadPool pool(nrThreads);
+	vector<double> costs(items, 1.0);
+	tStealContext context;
+	long long tasks = 0, stolen = 0, moved = 0;
+	bool ok = true;
+	int i;
+
+	context.runs.assign(items, 0);
+	context.runner.assign(items, -1);
+	context.slow = items / nrThreads;
+	pool.parallelFor(items, &stealItem, &context, costs);
+
+	for (i = 0; i < items; ++i)
+	{
+		if (context.runs[i] != 1)
+		{
+			cerr << "item " << i << " ran " << context.runs[i] << " times." << endl;
+			ok = false;
+		}
+
+		// equal costs seed thread t with the t-th quarter of the items
+		if (context.runner[i] != i / context.slow)
+		{
+			++moved;
+		}
+	}
+
+	for (i = 0; i < nrThreads; ++i)
+	{
+		tasks += pool.stats(i).tasks;
+		stolen += pool.stats(i).stolen;
+	}
+
+	if (tasks != items || stolen != moved)
+	{
+		cerr << "the pool counted " << tasks << " tasks and " << stolen << " stolen, " << items << " items ran and " << moved << " of them outside their block." << endl;
+		ok = false;
+	}
+
+	if (moved == 0)
+	{
+		cerr << "no thread took work off the slow block." << endl;
+		ok = false;
+	}
+
+	return ok;
+}
+
+// one color, drawn the way executeGame() and the sampled games draw it
+static int drawColor(tRandom &rng)
+{
+	if ((numColors & (numColors - 1)) == 0)
+	{
+		return (int)rng.nextBits(numInputs);
+	}
+
+	return (int)rng.nextInt(numColors);
+}
+
+bool tSelfCheck::batchGames(uint64_t seed, int agents)
+{
+	const int games = 256;
+	tGame game;
+	tAgent *agent = new tAgent;
+	int checked = 0;
+	bool ok = true;
+
+	for (int a = 0; ok && a < agents; ++a)
+	{
+		agent->rng = tRandom::stream(seed, RNG_SETUP, 1, a);
+		agent->setupRandomAgent(5000);
+		agent->setupPhenotype();
+
+		// random numbers in the gates would be drawn in a different order
+		if (!agent->brain.isDeterministic())
+		{
+			continue;
+		}
+
+		++checked;
+
+		const tRandom start = agent->rng;
+		vector<double> fitnesses = game.executeGameBatch(agent, games);
+
+		agent->rng = start;
+
+		for (int k = 0; ok && k < games; ++k)
+		{
+			game.executeGame(agent, NULL, false);
+
+			if (agent->fitness != fitnesses[k])
+			{
+				cerr << "agent " << a << ": sliced game " << k << " scored " << fitnesses[k] << ", executeGame " << agent->fitness << "." << endl;
+				ok = false;
+			}
+		}
+	}
+
+	if (checked == 0)
+	{
+		cerr << "none of " << agents << " agents had a deterministic brain to check." << endl;
+		ok = false;
+	}
+
+	delete agent;
+
+	return ok;
+}
+
+bool tSelfCheck::exactEvaluation(uint64_t seed, int agents)
+{
+	const int games = 4096;
+	tGame game;
+	tAgent *agent = new tAgent;
+	const int sequences = game.sequenceSpaceSize(INT_MAX - 1);
+	int checked = 0;
+	bool ok = true;
+
+	for (int a = 0; ok && a < agents; ++a)
+	{
+		agent->rng = tRandom::stream(seed, RNG_SETUP, 2, a);
+		agent->setupRandomAgent(5000);
+		agent->setupPhenotype();
+
+		// only deterministic brains are evaluated exactly
+		if (!agent->brain.isDeterministic())
+		{
+			continue;
+		}
+
+		++checked;
+
+		const double exact = game.executeGameExact(agent, 64, NULL);
+		tRandom colors = agent->rng;
+		vector<double> fitnesses = game.executeGameBatch(agent, games);
+		vector<double> bySequence(sequences, -1.0);
+		double total = 0.0;
+		int k, s;
+
+		// replay the colors of every sampled game to know which sequence it played
+		for (k = 0; ok && k < games; ++k)
+		{
+			s = 0;
+
+			for (int i = 0; i < maxRound; ++i)
+			{
+				s = s * numColors + drawColor(colors);
+			}
+
+			if (bySequence[s] < 0.0)
+			{
+				bySequence[s] = fitnesses[k];
+			}
+			else if (bySequence[s] != fitnesses[k])
+			{
+				cerr << "agent " << a << ": two sampled games of the same colors scored differently." << endl;
+				ok = false;
+			}
+		}
+
+		for (s = 0; ok && s < sequences; ++s)
+		{
+			if (bySequence[s] < 0.0)
+			{
+				cerr << "agent " << a << ": " << games << " sampled games missed a color sequence." << endl;
+				ok = false;
+			}
+
+			total += bySequence[s];
+		}
+
+		if (ok && fabs(total / (double)sequences - exact) > 1e-9)
+		{
+			cerr << "agent " << a << ": exact evaluation " << exact << ", sampled games over all sequences " << total / (double)sequences << "." << endl;
+			ok = false;
+		}
+	}
+
+	if (checked == 0)
+	{
+		cerr << "none of " << agents << " agents had a deterministic brain to check." << endl;
+		ok = false;
+	}
+
+	delete agent;
+
+	return ok;
+}
+
+bool tSelfCheck::exactPrefixes(uint64_t seed, int agents)
+{
+	tGame game;
+	tAgent *agent = new tAgent;
+	const int sequences = game.sequenceSpaceSize(INT_MAX - 1);
+	const int games = 64 * sequences;
+	vector<double> played, enumerated;
+	int checked = 0;
+	bool ok = true;
+
+	for (int a = 0; ok && a < agents; ++a)
+	{
+		agent->rng = tRandom::stream(seed, RNG_SETUP, 3, a);
+		agent->setupRandomAgent(5000);
+		agent->setupPhenotype();
+
+		if (!agent->brain.isDeterministic())
+		{
+			continue;
+		}
+
+		++checked;
+
+		// every sequence played one game at a time
+		tRandom colors = agent->rng;
+		int k, s;
+
+		played.assign(sequences, -1.0);
+
+		for (k = 0; k < games; ++k)
+		{
+			s = 0;
+
+			for (int i = 0; i < maxRound; ++i)
+			{
+				s = s * numColors + drawColor(colors);
+			}
+
+			game.executeGame(agent, NULL, false);
+			played[s] = agent->fitness;
+		}
+
+		for (s = 0; ok && s < sequences; ++s)
+		{
+			if (played[s] < 0.0)
+			{
+				cerr << "agent " << a << ": " << games << " games missed a color sequence." << endl;
+				ok = false;
+			}
+		}
+
+		// down to one lane, where every color but the last is played on the shared prefix
+		for (int lanes = 64; ok && lanes >= 1; lanes /= 2)
+		{
+			game.executeGameExact(agent, lanes, &enumerated);
+
+			for (s = 0; ok && s < sequences; ++s)
+			{
+				if (enumerated[s] != played[s])
+				{
+					cerr << "agent " << a << ": sequence " << s << " enumerated with " << lanes << " lanes scored " << enumerated[s] << ", executeGame " << played[s] << "." << endl;
+					ok = false;
+				}
+			}
+		}
+	}
+
+	if (checked == 0)
+	{
+		cerr << "none of " << agents << " agents had a deterministic brain to check." << endl;
+		ok = false;
+	}
+
+	delete agent;
+
+	return ok;
+}
+
+// breeds short lines of descent and builds every offspring both ways. the
+// duplication and deletion rates are high so that genes get moved and cut;
+// the mutations wear the genes down, so every line starts from a new genome
+bool tSelfCheck::phenotypeRebuild(uint64_t seed, int generations)
+{
+	tAgent *parent = NULL, *child, *full;
+	bool ok = true;
+
+	for (int g = 1; ok && g <= generations; ++g)
+	{
+		if (g % 10 == 1)
+		{
+			delete parent;
+			parent = new tAgent;
+			parent->rng = tRandom::stream(seed, RNG_SETUP, 4, g);
+			setupDenseAgent(parent, 5000);
+		}
+
+		child = new tAgent;
+		child->rng = tRandom::stream(seed, RNG_REPRODUCTION, g, 0);
+		child->inherit(parent, 0.002, 0.5, 0.5, g);
+
+		full = new tAgent;
+		full->editGenome() = child->info->genome.bytes();
+		full->setupPhenotype();
+
+		if (!sameGates(child, full))
+		{
+			cerr << "generation " << g << ": setupPhenotypeFrom() and setupPhenotype() built different gates." << endl;
+			ok = false;
+		}
+
+		delete full;
+		delete parent;
+		parent = child;
+	}
+
+	delete parent;
+
+	return ok;
+}
+
+// every genome size up to a few vector widths, so that the wrapping codon
+// and the tails behind the vector blocks are covered, and a long genome
+bool tSelfCheck::codonScan(uint64_t seed)
+{
+	const unsigned char codonBytes[4] = { 42, 255 - 42, 41, 255 - 41 };
+	vector<unsigned char> genome;
+	vector<int> gates, nodeMapGenes, naiveGates, naiveNodeMapGenes;
+	bool ok = true;
+
+	for (int size = 0; ok && size <= 5000; size = (size < 200) ? size + 1 : size + 800)
+	{
+		tRandom rng = tRandom::stream(seed, RNG_SETUP, 5, size);
+
+		genome.resize(size);
+
+		for (int i = 0; i < size; ++i)
+		{
+			genome[i] = (rng.nextBits(1) == 0) ? codonBytes[rng.nextBits(2)] : (unsigned char)rng.nextBits(8);
+		}
+
+		naiveGates.clear();
+		naiveNodeMapGenes.clear();
+
+		for (int i = 0; i < size; ++i)
+		{
+			const unsigned char first = genome[i], second = genome[(i + 1) % size];
+
+			if ((first == 42) && (second == 255 - 42))
+			{
+				naiveGates.push_back(i);
+			}
+			else if ((first == 41) && (second == 255 - 41))
+			{
+				naiveNodeMapGenes.push_back(i);
+			}
+		}
+
+		tCodonScanner::scan(genome, gates, nodeMapGenes);
+
+		if (gates != naiveGates || nodeMapGenes != naiveNodeMapGenes)
+		{
+			cerr << "genome of " << size << " bytes: the scanner found " << gates.size() << " gates and " << nodeMapGenes.size() << " node map genes, a byte by byte scan " << naiveGates.size() << " and " << naiveNodeMapGenes.size() << "." << endl;
+			ok = false;
+		}
+	}
+
+	return ok;
+}
+
+// inherit() skips from one mutated site to the next; a draw per site is the
+// reference. compares the distribution of the number of mutations and of
+// their positions, and the rates that mutate no site and every site
+bool tSelfCheck::mutationSites(uint64_t seed, int offspring)
+{
+	const int sites = 5000, bins = 50;
+	const double rate = 0.005;
+	tAgent *parent = new tAgent, *child = new tAgent;
+	vector<double> skipCounts(sites + 1, 0.0), siteCounts(sites + 1, 0.0);
+	vector<double> skipPositions(bins, 0.0), sitePositions(bins, 0.0);
+	int k, i, degrees;
+	bool ok = true;
+
+	parent->editGenome().assign(sites, 0);
+
+	for (k = 0; k < offspring; ++k)
+	{
+		child->resetAgent();
+		child->rng = tRandom::stream(seed, RNG_REPRODUCTION, 6, k);
+		child->inherit(parent, rate, 0.0, 0.0, 1);
+
+		skipCounts[child->info->delta.pointPositions.size()] += 1.0;
+
+		for (i = 0; i < (int)child->info->delta.pointPositions.size(); ++i)
+		{
+			skipPositions[child->info->delta.pointPositions[i] * bins / sites] += 1.0;
+		}
+
+		tRandom rng = tRandom::stream(seed, RNG_REPRODUCTION, 7, k);
+		int mutations = 0;
+
+		for (i = 0; i < sites; ++i)
+		{
+			if (rng.nextDouble() < rate)
+			{
+				sitePositions[i * bins / sites] += 1.0;
+				++mutations;
+			}
+		}
+
+		siteCounts[mutations] += 1.0;
+	}
+
+	const double countStatistic = chiSquareTwoSample(skipCounts, siteCounts, degrees);
+
+	if (countStatistic > chiSquareCritical(degrees))
+	{
+		cerr << "number of mutations: chi-square " << countStatistic << " with " << degrees << " degrees of freedom." << endl;
+		ok = false;
+	}
+
+	const double positionStatistic = chiSquareTwoSample(skipPositions, sitePositions, degrees);
+
+	if (positionStatistic > chiSquareCritical(degrees))
+	{
+		cerr << "mutation positions: chi-square " << positionStatistic << " with " << degrees << " degrees of freedom." << endl;
+		ok = false;
+	}
+
+	for (k = 0; k < 2; ++k)
+	{
+		child->resetAgent();
+		child->rng = tRandom::stream(seed, RNG_REPRODUCTION, 8, k);
+		child->inherit(parent, (double)k, 0.0, 0.0, 1);
+
+		if ((int)child->info->delta.pointPositions.size() != k * sites)
+		{
+			cerr << "rate " << k << " mutated " << child->info->delta.pointPositions.size() << " of " << sites << " sites." << endl;
+			ok = false;
+		}
+	}
+
+	delete parent;
+	delete child;
+
+	return ok;
+}
+
+// random edits on a few genomes that share each other's bytes, each mirrored
+// by a plain byte vector. reading flattens a genome, so only every few edits
+// one genome is compared, to let the piece lists grow in between
+bool tSelfCheck::genomePieces(uint64_t seed, int edits)
+{
+	const int count = 4;
+	tGenome genomes[count];
+	vector<unsigned char> mirrors[count];
+	tRandom rng = tRandom::stream(seed, RNG_SETUP, 9, 0);
+	bool ok = true;
+	int g;
+
+	for (int e = 0; ok && e < edits; ++e)
+	{
+		g = (int)rng.nextInt(count);
+
+		tGenome &genome = genomes[g];
+		vector<unsigned char> &mirror = mirrors[g];
+		const int size = (int)mirror.size();
+		const int operation = (int)rng.nextInt(100);
+
+		if (operation < 2 || size == 0)
+		{
+			// a new genome of its own
+			vector<unsigned char> &bytes = genome.edit();
+
+			bytes.resize(1 + rng.nextInt(3000));
+
+			for (int i = 0; i < (int)bytes.size(); ++i)
+			{
+				bytes[i] = (unsigned char)rng.nextBits(8);
+			}
+
+			mirror = bytes;
+		}
+		else if (operation < 4)
+		{
+			genome.clear();
+			mirror.clear();
+		}
+		else if (operation < 12)
+		{
+			const int from = (g + 1 + (int)rng.nextInt(count - 1)) % count;
+
+			genome.share(genomes[from]);
+			mirror = mirrors[from];
+		}
+		else if (operation < 70)
+		{
+			const int position = (int)rng.nextInt(size);
+			const unsigned char value = (unsigned char)rng.nextBits(8);
+
+			genome.set(position, value);
+			mirror[position] = value;
+		}
+		else if (operation < 85)
+		{
+			const int width = 1 + (int)rng.nextInt((size < 512) ? size : 512);
+			const int start = (int)rng.nextInt(size - width + 1);
+			const int offset = (int)rng.nextInt(size + 1);
+			vector<unsigned char> copy(mirror.begin() + start, mirror.begin() + start + width);
+
+			genome.duplicate(start, width, offset);
+			mirror.insert(mirror.begin() + offset, copy.begin(), copy.end());
+		}
+		else
+		{
+			const int width = 1 + (int)rng.nextInt((size < 512) ? size : 512);
+			const int start = (int)rng.nextInt(size - width + 1);
+
+			genome.erase(start, width);
+			mirror.erase(mirror.begin() + start, mirror.begin() + start + width);
+		}
+
+		if (genome.size() != (int)mirror.size())
+		{
+			cerr << "edit " << e << ": genome of " << genome.size() << " bytes, should have " << mirror.size() << "." << endl;
+			ok = false;
+		}
+
+		if (ok && rng.nextInt(20) == 0)
+		{
+			g = (int)rng.nextInt(count);
+
+			if (genomes[g].bytes() != mirrors[g])
+			{
+				cerr << "edit " << e << ": genome " << g << " differs from its flat copy." << endl;
+				ok = false;
+			}
+		}
+	}
+
+	for (g = 0; ok && g < count; ++g)
+	{
+		if (genomes[g].bytes() != mirrors[g])
+		{
+			cerr << "genome " << g << " differs from its flat copy at the end." << endl;
+			ok = false;
+		}
+	}
+
+	return ok;
+}
+
+// evolves a small population with random parents and high duplication and
+// deletion rates. every agent's genome, and its parent's, must come back from
+// the phylogeny unchanged while its root moves down the line of descent
+bool tSelfCheck::phylogenyGenomes(uint64_t seed, int generations)
+{
+	const int n = 20;
+	tAgent *store = new tAgent[2 * n];
+	tAgent *seedAgent = new tAgent;
+	tPhylogeny phylogeny;
+	vector<unsigned char> genome, migrant;
+	int parents[n];
+	bool ok = true;
+	int i;
+
+	seedAgent->rng = tRandom::stream(seed, RNG_SETUP, 10, 0);
+	setupDenseAgent(seedAgent, 5000);
+	seedAgent->info->phylogenyNode = phylogeny.addRoot(seedAgent->info->genome.bytes(), seedAgent->info->ID, 0);
+
+	for (i = 0; i < n; ++i)
+	{
+		store[i].rng = tRandom::stream(seed, RNG_SETUP, 10, 1 + i);
+		store[i].inherit(seedAgent, 0.01, 0.5, 0.5, 0);
+		store[i].info->phylogenyNode = phylogeny.addChild(seedAgent->info->phylogenyNode, store[i].info->delta, store[i].info->ID, 0, store[i].info->genome.size());
+	}
+
+	phylogeny.retire(seedAgent->info->phylogenyNode);
+	delete seedAgent;
+
+	for (int g = 1; ok && g <= generations; ++g)
+	{
+		tAgent *population = &store[((g - 1) & 1) * n], *offspring = &store[(g & 1) * n];
+
+		for (i = 0; i < n; ++i)
+		{
+			offspring[i].resetAgent();
+			offspring[i].rng = tRandom::stream(seed, RNG_REPRODUCTION, g, i);
+			// the last place holds the line of a single migrant that never mixes
+			// with the others; every few generations another migrant takes the
+			// first place, as on an island
+			parents[i] = (i == n - 1) ? n - 1 : (int)offspring[i].rng.nextInt(n - 1);
+
+			if ((i == 0 && g % 5 == 0) || (i == n - 1 && g == 1))
+			{
+				tRandom rng = tRandom::stream(seed, RNG_MIGRATION, g, 0);
+
+				migrant.resize(1000 + rng.nextInt(1000));
+
+				for (int j = 0; j < (int)migrant.size(); ++j)
+				{
+					migrant[j] = (unsigned char)rng.nextBits(8);
+				}
+
+				parents[i] = -1;
+				offspring[i].immigrate(migrant, g);
+				offspring[i].info->phylogenyNode = phylogeny.addImmigrant(offspring[i].info->delta, offspring[i].info->ID, g, offspring[i].info->genome.size());
+				continue;
+			}
+
+			offspring[i].inherit(&population[parents[i]], 0.01, 0.5, 0.5, g);
+			offspring[i].info->phylogenyNode = phylogeny.addChild(population[parents[i]].info->phylogenyNode, offspring[i].info->delta, offspring[i].info->ID, g, offspring[i].info->genome.size());
+		}
+
+		for (i = 0; i < n; ++i)
+		{
+			phylogeny.retire(population[i].info->phylogenyNode);
+		}
+
+		phylogeny.coalesce();
+
+		for (i = 0; ok && i < n; ++i)
+		{
+			phylogeny.rebuildGenome(offspring[i].info->phylogenyNode, genome);
+
+			if (genome != offspring[i].info->genome.bytes())
+			{
+				cerr << "generation " << g << ": the genome of agent " << i << " was rebuilt wrong." << endl;
+				ok = false;
+			}
+
+			// the line of an agent whose parent left the tree starts with the agent
+			const int ancestor = phylogeny.getAncestor(offspring[i].info->phylogenyNode, 1);
+
+			if (parents[i] < 0 || ancestor == offspring[i].info->phylogenyNode)
+			{
+				continue;
+			}
+
+			phylogeny.rebuildGenome(ancestor, genome);
+
+			if (ok && genome != population[parents[i]].info->genome.bytes())
+			{
+				cerr << "generation " << g << ": the genome of the parent of agent " << i << " was rebuilt wrong." << endl;
+				ok = false;
+			}
+		}
+	}
+
+	// without coalescence the line from the seed alone would hold a node per
+	// generation, and so would the line of the migrant that lives beside it
+	const int inUse = (int)(phylogeny.nodes.size() - phylogeny.freeNodes.size());
+
+	if (ok && inUse > generations / 2)
+	{
+		cerr << "the phylogeny still holds " << inUse << " nodes after " << generations << " generations." << endl;
+		ok = false;
+	}
+
+	delete[] store;
+
+	return ok;
+}
+
+bool tSelfCheck::genomeFiles(uint64_t seed)
+{
+	const int lengths[] = { 0, 1, 100, 5000 };
+	const int n = sizeof(lengths) / sizeof(lengths[0]);
+	const char *binaryName = "check-genome.bin";
+	const char *textName = "check-genome.txt";
+	tRandom rng = tRandom::stream(seed, RNG_SETUP, 11, 0);
+	vector<unsigned char> genome, loaded;
+	unsigned char header[genomeFileHeaderSize];
+	bool ok = true;
+
+	for (int i = 0; ok && i < n; ++i)
+	{
+		tGenomeFile file;
+
+		genome.resize(lengths[i]);
+
+		for (int j = 0; j < lengths[i]; ++j)
+		{
+			genome[j] = (unsigned char)rng.nextBits(8);
+		}
+
+		const unsigned char *bytes = genome.empty() ? NULL : &genome[0];
+
+		if (!tGenomeFile::saveBinary(binaryName, bytes, genome.size())
+			|| !tGenomeFile::isBinary(binaryName)
+			|| !tGenomeFile::load(binaryName, loaded) || loaded != genome
+			|| !file.open(binaryName) || file.size() != genome.size()
+			|| (!genome.empty() && memcmp(file.data(), bytes, genome.size()) != 0))
+		{
+			cerr << "a genome of " << lengths[i] << " bytes did not come back from a binary file." << endl;
+			ok = false;
+		}
+
+		file.close();
+
+		if (!tGenomeFile::saveText(textName, bytes, genome.size())
+			|| tGenomeFile::isBinary(textName)
+			|| !tGenomeFile::load(textName, loaded) || loaded != genome)
+		{
+			cerr << "a genome of " << lengths[i] << " bytes did not come back from a text file." << endl;
+			ok = false;
+		}
+	}
+
+	// the length sits at offset 16, most significant byte first
+	FILE *f = fopen(binaryName, "rb");
+
+	if (ok && (f == NULL || fread(header, sizeof(header), 1, f) != 1))
+	{
+		cerr << "the binary genome file could not be read back." << endl;
+		ok = false;
+	}
+
+	for (int j = 0; ok && j < 8; ++j)
+	{
+		if (header[16 + j] != (unsigned char)((uint64_t)genome.size() >> (8 * (7 - j))))
+		{
+			cerr << "the header of a binary genome file is not in big-endian byte order." << endl;
+			ok = false;
+		}
+	}
+
+	if (f != NULL)
+	{
+		fclose(f);
+	}
+
+	// a flipped byte fails the checksum, a cut off file the length
+	if (ok)
+	{
+		tGenomeFile file;
+
+		f = fopen(binaryName, "r+b");
+		ok = f != NULL && fseek(f, genomeFileHeaderSize + (long)genome.size() / 2, SEEK_SET) == 0 && fputc(genome[genome.size() / 2] ^ 1, f) != EOF;
+
+		if (f != NULL)
+		{
+			fclose(f);
+		}
+
+		if (!ok || file.open(binaryName) || tGenomeFile::load(binaryName, loaded))
+		{
+			cerr << "a binary genome file with a flipped byte was accepted." << endl;
+			ok = false;
+		}
+
+		ok = ok && tGenomeFile::saveBinary(binaryName, &genome[0], genome.size()) && truncate(binaryName, genomeFileHeaderSize + genome.size() - 1) == 0;
+
+		if (!ok || file.open(binaryName))
+		{
+			cerr << "a cut off binary genome file was accepted." << endl;
+			ok = false;
+		}
+	}
+
+	unlink(binaryName);
+	unlink(textName);
+
+	return ok;
+}
+
+bool tSelfCheck::genomeArchive(uint64_t seed)
+{
+	const int lengths[] = { 1, 100, 5000, 0, 17 };
+	const int n = sizeof(lengths) / sizeof(lengths[0]);
+	const char *archiveName = "check-genome.archive";
+	tRandom rng = tRandom::stream(seed, RNG_SETUP, 12, 0);
+	vector<vector<unsigned char> > genomes(n);
+	vector<unsigned char> loaded;
+	tGenomeArchive archive;
+	unsigned char header[genomeArchiveHeaderSize];
+	struct stat st;
+	bool ok;
+	int i;
+
+	for (i = 0; i < n; ++i)
+	{
+		genomes[i].resize(lengths[i]);
+
+		for (int j = 0; j < lengths[i]; ++j)
+		{
+			genomes[i][j] = (unsigned char)rng.nextBits(8);
+		}
+	}
+
+	// one record per generation 0, 10, 20, ...
+	ok = archive.create(archiveName);
+
+	for (i = 0; ok && i < n; ++i)
+	{
+		ok = archive.append(10 * i, genomes[i]);
+	}
+
+	archive.close();
+	ok = ok && archive.open(archiveName) && archive.size() == n && archive.find(15) < 0;
+
+	for (i = 0; ok && i < n; ++i)
+	{
+		size_t length;
+
+		ok = archive.generation(i) == 10 * i && archive.find(10 * i) == i && archive.load(i, loaded) && loaded == genomes[i]
+			&& archive.data(i, length) != NULL && length == genomes[i].size();
+	}
+
+	archive.close();
+
+	if (!ok)
+	{
+		cerr << "genomes did not come back from an archive." << endl;
+	}
+
+	// the version sits at offset 8, most significant byte first
+	FILE *f = fopen(archiveName, "r+b");
+
+	if (ok && (f == NULL || fread(header, sizeof(header), 1, f) != 1
+		|| header[8] != 0 || header[9] != 0 || header[10] != 0 || header[11] != genomeArchiveVersion))
+	{
+		cerr << "the header of an archive is not in big-endian byte order." << endl;
+		ok = false;
+	}
+
+	// a flipped byte in the first genome fails its checksum, and only its own
+	if (ok && (fseek(f, genomeArchiveHeaderSize + genomeArchiveRecordSize, SEEK_SET) != 0 || fputc(genomes[0][0] ^ 1, f) == EOF))
+	{
+		ok = false;
+	}
+
+	if (f != NULL)
+	{
+		fclose(f);
+	}
+
+	if (ok && (!archive.open(archiveName) || archive.size() != n || archive.load(0, loaded) || !archive.load(1, loaded)))
+	{
+		cerr << "an archive with a flipped byte was read wrong." << endl;
+		ok = false;
+	}
+
+	archive.close();
+
+	// without an intact index, as while a record is being written, the
+	// records are walked instead
+	if (ok && (stat(archiveName, &st) != 0 || truncate(archiveName, st.st_size - 1) != 0
+		|| !archive.open(archiveName) || archive.size() != n || archive.find(10 * (n - 1)) != n - 1
+		|| !archive.load(n - 1, loaded) || loaded != genomes[n - 1]))
+	{
+		cerr << "an archive without its index was read wrong." << endl;
+		ok = false;
+	}
+
+	archive.close();
+
+	// a resumed run drops the records after its checkpoint and goes on from there
+	ok = ok && archive.resume(archiveName, 20) && archive.append(30, genomes[n - 1]);
+	archive.close();
+
+	if (ok && (!archive.open(archiveName) || archive.size() != 4 || archive.find(40) >= 0
+		|| archive.find(20) != 2 || !archive.load(2, loaded) || loaded != genomes[2]
+		|| archive.find(30) != 3 || !archive.load(3, loaded) || loaded != genomes[n - 1]))
+	{
+		cerr << "a resumed archive did not hold the records it should." << endl;
+		ok = false;
+	}
+
+	archive.close();
+	unlink(archiveName);
+
+	return ok;
+}
+
+bool tSelfCheck::checkpoints(uint64_t seed, int generations)
+{
+	const int n = 20;
+	const char *checkpointName = "check-checkpoint";
+	tPhylogeny phylogeny, restored;
+	tAgent *store = new tAgent[2 * n];
+	tAgent *seedAgent = new tAgent;
+	tAgent *population = store;
+	tAgent copy;
+	tCheckpoint checkpoint;
+	vector<int> ints, loadedInts;
+	vector<unsigned char> genome;
+	unsigned char bytes[48];
+	int i;
+
+	seedAgent->rng = tRandom::stream(seed, RNG_SETUP, 13, 0);
+	setupDenseAgent(seedAgent, 5000);
+	seedAgent->info->phylogenyNode = phylogeny.addRoot(seedAgent->info->genome.bytes(), seedAgent->info->ID, 0);
+
+	for (i = 0; i < n; ++i)
+	{
+		store[i].rng = tRandom::stream(seed, RNG_SETUP, 13, 1 + i);
+		store[i].inherit(seedAgent, 0.01, 0.5, 0.5, 0);
+		store[i].info->phylogenyNode = phylogeny.addChild(seedAgent->info->phylogenyNode, store[i].info->delta, store[i].info->ID, 0, store[i].info->genome.size());
+	}
+
+	phylogeny.retire(seedAgent->info->phylogenyNode);
+	delete seedAgent;
+
+	for (int g = 1; g <= generations; ++g)
+	{
+		tAgent *offspring = &store[(g & 1) * n];
+
+		for (i = 0; i < n; ++i)
+		{
+			offspring[i].resetAgent();
+			offspring[i].rng = tRandom::stream(seed, RNG_REPRODUCTION, g, i);
+			tAgent *parent = &population[offspring[i].rng.nextInt(n)];
+			offspring[i].inherit(parent, 0.01, 0.5, 0.5, g);
+			offspring[i].info->phylogenyNode = phylogeny.addChild(parent->info->phylogenyNode, offspring[i].info->delta, offspring[i].info->ID, g, offspring[i].info->genome.size());
+		}
+
+		for (i = 0; i < n; ++i)
+		{
+			phylogeny.retire(population[i].info->phylogenyNode);
+		}
+
+		phylogeny.coalesce();
+		population = offspring;
+	}
+
+	ints.push_back(-1);
+	ints.push_back(0);
+	ints.push_back(INT_MAX);
+	ints.push_back(INT_MIN);
+
+	checkpoint.putInt(-7);
+	checkpoint.putUInt64(0x0123456789abcdefULL);
+	checkpoint.putDouble(-0.1);
+	checkpoint.putString("lineage");
+	checkpoint.putIntVector(ints);
+	phylogeny.saveState(checkpoint);
+
+	for (i = 0; i < n; ++i)
+	{
+		population[i].saveState(checkpoint);
+	}
+
+	bool ok = checkpoint.save(checkpointName) && checkpoint.load(checkpointName)
+		&& checkpoint.getInt() == -7 && checkpoint.getUInt64() == 0x0123456789abcdefULL
+		&& checkpoint.getDouble() == -0.1 && checkpoint.getString() == "lineage";
+
+	checkpoint.getIntVector(loadedInts);
+	ok = ok && loadedInts == ints;
+
+	if (!ok)
+	{
+		cerr << "values did not come back from a checkpoint." << endl;
+	}
+
+	// the agents and the genomes rebuilt from the restored phylogeny are the ones saved
+	if (ok)
+	{
+		restored.loadState(checkpoint);
+
+		for (i = 0; ok && i < n; ++i)
+		{
+			copy.loadState(checkpoint);
+			restored.rebuildGenome(copy.info->phylogenyNode, genome);
+
+			ok = !checkpoint.failed && copy.info->genome.bytes() == population[i].info->genome.bytes() && genome == copy.info->genome.bytes()
+				&& copy.info->ID == population[i].info->ID && copy.info->born == population[i].info->born
+				&& copy.info->phylogenyNode == population[i].info->phylogenyNode;
+		}
+
+		// a get past the end fails
+		checkpoint.getInt();
+		ok = ok && checkpoint.failed;
+
+		if (!ok)
+		{
+			cerr << "the population or its phylogeny did not come back from a checkpoint." << endl;
+		}
+	}
+
+	// the first two values follow the header, most significant byte first
+	FILE *f = fopen(checkpointName, "r+b");
+
+	if (ok && (f == NULL || fread(bytes, sizeof(bytes), 1, f) != 1
+		|| bytes[32] != 0xff || bytes[39] != 0xf9 || bytes[40] != 0x01 || bytes[47] != 0xef))
+	{
+		cerr << "a checkpoint is not in big-endian byte order." << endl;
+		ok = false;
+	}
+
+	// a flipped byte fails the checksum, a cut off file the length
+	if (ok && (fseek(f, 40, SEEK_SET) != 0 || fputc(0x00, f) == EOF))
+	{
+		ok = false;
+	}
+
+	if (f != NULL)
+	{
+		fclose(f);
+	}
+
+	if (ok && checkpoint.load(checkpointName))
+	{
+		cerr << "a checkpoint with a flipped byte was accepted." << endl;
+		ok = false;
+	}
+
+	struct stat st;
+
+	if (ok)
+	{
+		checkpoint.clear();
+		checkpoint.putInt(1);
+		ok = checkpoint.save(checkpointName) && stat(checkpointName, &st) == 0 && truncate(checkpointName, st.st_size - 1) == 0;
+
+		if (!ok || checkpoint.load(checkpointName))
+		{
+			cerr << "a cut off checkpoint was accepted." << endl;
+			ok = false;
+		}
+	}
+
+	unlink(checkpointName);
+	delete[] store;
+
+	return ok;
+}
+
+bool tSelfCheck::selection(uint64_t seed, int draws)
+{
+	const int n = 50;
+	const char *methodNames[] = { "roulette", "tournament", "truncation" };
+	tRandom rng = tRandom::stream(seed, RNG_SETUP, 14, 0);
+	vector<double> fitness(n), drawn(n), expected(n);
+	bool ok = true;
+	int i;
+
+	for (int skew = 0; skew < 2; ++skew)
+	{
+		double rest = 0.0;
+
+		// a spread of fitnesses with ties and zeros; the second time agent 0
+		// holds two thirds of all fitness
+		for (i = 0; i < n; ++i)
+		{
+			fitness[i] = (i % 7 == 0) ? 0.0 : floor(10.0 * rng.nextDouble()) + 1.0;
+			rest += (i == 0) ? 0.0 : fitness[i];
+		}
+
+		fitness[0] = (skew == 1) ? 2.0 * rest : 3.0;
+
+		for (int method = SELECTION_ROULETTE; method <= SELECTION_TRUNCATION; ++method)
+		{
+			for (int exclude = 0; exclude < n; exclude += n - 1)
+			{
+				tSelection fast;
+				int degrees;
+
+				fast.method = method;
+				fast.tournamentSize = 3;
+				fast.truncationFraction = 0.3;
+				fast.prepare(fitness);
+				fill(drawn.begin(), drawn.end(), 0.0);
+				fill(expected.begin(), expected.end(), 0.0);
+
+				tRandom fastRng = tRandom::stream(seed, RNG_REPRODUCTION, 14, 2 * method + skew);
+				tRandom referenceRng = tRandom::stream(seed, RNG_EVALUATION, 14, 2 * method + skew);
+
+				for (i = 0; i < draws; ++i)
+				{
+					drawn[fast.select(exclude, fastRng)] += 1.0;
+					expected[referenceSelect(fitness, fast, exclude, referenceRng)] += 1.0;
+				}
+
+				const double statistic = chiSquareTwoSample(drawn, expected, degrees);
+
+				if (drawn[exclude] != 0.0 || statistic > chiSquareCritical(degrees))
+				{
+					cerr << methodNames[method] << " selection" << (skew ? " with a dominant agent" : "") << ", agent " << exclude << " excluded: chi-square "
+						<< statistic << " with " << degrees << " degrees of freedom, " << drawn[exclude] << " draws of the excluded agent." << endl;
+					ok = false;
+				}
+			}
+		}
+	}
+
+	return ok;
+}
+
+bool tSelfCheck::migrationMessages(uint64_t seed)
+{
+	const int lengths[] = { 1, 100, 5000 };
+	const int n = sizeof(lengths) / sizeof(lengths[0]);
+	tRandom rng = tRandom::stream(seed, RNG_SETUP, 15, 0);
+	vector<vector<unsigned char> > genomes(n), decoded;
+	vector<unsigned char> first, second, stream;
+	size_t length = 0;
+	bool ok = true;
+	int i;
+
+	for (i = 0; i < n; ++i)
+	{
+		genomes[i].resize(lengths[i]);
+
+		for (int j = 0; j < lengths[i]; ++j)
+		{
+			genomes[i][j] = (unsigned char)rng.nextBits(8);
+		}
+	}
+
+	// two messages back to back, as they come in on a connection
+	tIsland::encodeMessage(3, 70000, genomes, first);
+	tIsland::encodeMessage(4, 1, vector<vector<unsigned char> >(genomes.begin(), genomes.begin() + 1), second);
+	stream = first;
+	stream.insert(stream.end(), second.begin(), second.end());
+
+	if (tIsland::decodeMessage(&stream[0], stream.size(), length, decoded) != 1 || length != first.size() || decoded != genomes
+		|| tIsland::decodeMessage(&stream[0] + length, stream.size() - length, length, decoded) != 1 || length != second.size()
+		|| decoded.size() != 1 || decoded[0] != genomes[0])
+	{
+		cerr << "migrants did not come back from their messages." << endl;
+		ok = false;
+	}
+
+	// sender and generation follow the magic, most significant byte first
+	if (ok && (first[8] != 0 || first[11] != 3 || first[13] != 1 || first[14] != 0x11 || first[15] != 0x70))
+	{
+		cerr << "the header of a message is not in big-endian byte order." << endl;
+		ok = false;
+	}
+
+	// a message cut off anywhere waits for the rest
+	const size_t cuts[] = { 0, 8, 19, 20, 31, 32, 33, first.size() - 1 };
+
+	for (i = 0; ok && i < (int)(sizeof(cuts) / sizeof(cuts[0])); ++i)
+	{
+		if (tIsland::decodeMessage(&first[0], cuts[i], length, decoded) != 0)
+		{
+			cerr << "a message cut off after " << cuts[i] << " bytes was not left to wait for the rest." << endl;
+			ok = false;
+		}
+	}
+
+	// a wrong magic, a count or a length out of bounds, or a genome that does
+	// not match its checksum is rejected
+	const size_t damaged[] = { 0, 16, 20, first.size() - 1 };
+
+	for (i = 0; ok && i < (int)(sizeof(damaged) / sizeof(damaged[0])); ++i)
+	{
+		stream = first;
+		stream[damaged[i]] ^= 0x80;
+
+		if (tIsland::decodeMessage(&stream[0], stream.size(), length, decoded) != -1)
+		{
+			cerr << "a message with a flipped byte at offset " << damaged[i] << " was taken in." << endl;
+			ok = false;
+		}
+	}
+
+	return ok;
+}
+
+bool tSelfCheck::runAll(void)
+{
+	const uint64_t seed = 1;
+	bool ok = true;
+
+	cout << "thread count... " << flush;
+	ok = threadCount(seed) && ok;
+	cout << "work stealing... " << flush;
+	ok = workStealing(64) && ok;
+	cout << "batch games... " << flush;
+	ok = batchGames(seed, 100) && ok;
+	cout << "exact evaluation... " << flush;
+	ok = exactEvaluation(seed, 100) && ok;
+	cout << "exact prefixes... " << flush;
+	ok = exactPrefixes(seed, 20) && ok;
+	cout << "phenotype rebuild... " << flush;
+	ok = phenotypeRebuild(seed, 2000) && ok;
+	cout << "codon scan... " << flush;
+	ok = codonScan(seed) && ok;
+	cout << "mutation sites... " << flush;
+	ok = mutationSites(seed, 4000) && ok;
+	cout << "selection... " << flush;
+	ok = selection(seed, 100000) && ok;
+	cout << "genome pieces... " << flush;
+	ok = genomePieces(seed, 200000) && ok;
+	cout << "phylogeny genomes... " << flush;
+	ok = phylogenyGenomes(seed, 1000) && ok;
+	cout << "genome files... " << flush;
+	ok = genomeFiles(seed) && ok;
+	cout << "genome archive... " << flush;
+	ok = genomeArchive(seed) && ok;
+	cout << "checkpoints... " << flush;
+	ok = checkpoints(seed, 200) && ok;
+	cout << "migration messages... " << flush;
+	ok = migrationMessages(seed) && ok;
+	cout << (ok ? "all passed." : "FAILED.") << endl;
+
+	return ok;
+}
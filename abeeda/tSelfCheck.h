@@ -0,0 +1,76 @@
+/*
+ * tSelfCheck.h
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _tSelfCheck_h_included_
+#define _tSelfCheck_h_included_
+
+#include <stdint.h>
+
+// regression checks for what the faster code paths promise: that they give
+// exactly what the plain code would. every check returns true if it holds and
+// says on cerr what went wrong otherwise. -check runs them all; check-simon
+// runs -check together with the checks that need whole runs.
+class tSelfCheck{
+public:
+	// the fitnesses of a population do not depend on the number of threads
+	static bool threadCount(uint64_t seed);
+	// threads that run out of work take it from a thread that still has some,
+	// and the pool counts what was taken
+	static bool workStealing(int items);
+	// bit-sliced games of a deterministic brain score what executeGame()
+	// scores for the same colors
+	static bool batchGames(uint64_t seed, int agents);
+	// the exact evaluation is the average of the sampled games over all
+	// color sequences
+	static bool exactEvaluation(uint64_t seed, int agents);
+	// enumeration scores every color sequence as executeGame() does, however
+	// many of its colors are played on the shared prefix
+	static bool exactPrefixes(uint64_t seed, int agents);
+	// setupPhenotypeFrom() builds the same gates as a full setupPhenotype()
+	static bool phenotypeRebuild(uint64_t seed, int generations);
+	// the vectorized codon scanner finds what a byte by byte scan finds
+	static bool codonScan(uint64_t seed);
+	// point mutations hit as many sites, and the same ones, as a draw per site
+	static bool mutationSites(uint64_t seed, int offspring);
+	// every selection method picks parents as often as the plain sampler does
+	static bool selection(uint64_t seed, int draws);
+	// piece table edits give the bytes the same edits give a flat vector
+	static bool genomePieces(uint64_t seed, int edits);
+	// genomes rebuilt from the phylogeny's deltas are the agents' genomes, and
+	// coalescence keeps the phylogeny small, also with migrants coming in
+	static bool phylogenyGenomes(uint64_t seed, int generations);
+	// genomes come back unchanged from binary and text files, and damaged
+	// binary files are turned down
+	static bool genomeFiles(uint64_t seed);
+	// an archive gives back every genome by its generation, with or without
+	// the index at its end, and keeps what it should when a run resumes
+	static bool genomeArchive(uint64_t seed);
+	// a checkpoint gives back the values, agents and phylogeny put into it,
+	// and a damaged one is turned down
+	static bool checkpoints(uint64_t seed, int generations);
+	// migrants come back from the messages islands send each other, and a
+	// message that is cut off or damaged is not taken in
+	static bool migrationMessages(uint64_t seed);
+	// runs every check with the same fixed seed, so that a failure can be repeated
+	static bool runAll(void);
+};
+
+#endif
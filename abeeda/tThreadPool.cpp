@@ -0,0 +1,314 @@
+/*
+ * tThreadPool.cpp
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <time.h>
+#include "tThreadPool.h"
+
+#define packRange(first, last) (((uint64_t)(uint32_t)(first) << 32) | (uint64_t)(uint32_t)(last))
+#define rangeFirst(range) ((int)((range) >> 32))
+#define rangeLast(range) ((int)((range) & 0xffffffff))
+
+static double poolClock(void)
+{
+    struct timespec now;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    return (double)now.tv_sec + 1e-9 * (double)now.tv_nsec;
+}
+
+tThreadPool::tThreadPool(int nrThreads)
+{
+    if (nrThreads < 1)
+    {
+        nrThreads = 1;
+    }
+
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&wakeUp, NULL);
+    pthread_cond_init(&allDone, NULL);
+    currentTask = NULL;
+    currentContext = NULL;
+    queues.resize(nrThreads);
+    round = 0;
+    nrBusy = 0;
+    shuttingDown = false;
+    resetStats();
+
+    // thread 0 is the caller of parallelFor, so only nrThreads - 1 workers are spawned
+    workers.resize(nrThreads - 1);
+    workerInfo.resize(nrThreads - 1);
+
+    for (int i = 0; i < (int)workers.size(); ++i)
+    {
+        workerInfo[i].pool = this;
+        workerInfo[i].thread = i + 1;
+        pthread_create(&workers[i], NULL, &tThreadPool::workerMain, &workerInfo[i]);
+    }
+}
+
+tThreadPool::~tThreadPool()
+{
+    pthread_mutex_lock(&lock);
+    shuttingDown = true;
+    pthread_cond_broadcast(&wakeUp);
+    pthread_mutex_unlock(&lock);
+
+    for (int i = 0; i < (int)workers.size(); ++i)
+    {
+        pthread_join(workers[i], NULL);
+    }
+
+    pthread_cond_destroy(&allDone);
+    pthread_cond_destroy(&wakeUp);
+    pthread_mutex_destroy(&lock);
+}
+
+int tThreadPool::size(void)
+{
+    return (int)workers.size() + 1;
+}
+
+// runs task(i) for every i in [0, count) and returns once all of them have finished
+void tThreadPool::parallelFor(int count, tPoolTask task, void *context)
+{
+    run(count, task, context, NULL);
+}
+
+// the same, with costs[i] the expected cost of item i relative to the others
+void tThreadPool::parallelFor(int count, tPoolTask task, void *context, const vector<double> &costs)
+{
+    run(count, task, context, &costs);
+}
+
+tWorkerStats tThreadPool::stats(int thread)
+{
+    return queues[thread].stats;
+}
+
+// share of the time spent in parallel loops that the thread was running items
+double tThreadPool::utilisation(int thread)
+{
+    return (elapsed > 0.0) ? queues[thread].stats.busy / elapsed : 0.0;
+}
+
+void tThreadPool::resetStats(void)
+{
+    elapsed = 0.0;
+
+    for (int t = 0; t < (int)queues.size(); ++t)
+    {
+        queues[t].stats.busy = 0.0;
+        queues[t].stats.tasks = 0;
+        queues[t].stats.stolen = 0;
+    }
+}
+
+void tThreadPool::run(int count, tPoolTask task, void *context, const vector<double> *costs)
+{
+    int nrThreads = size();
+    double start = poolClock();
+    int first = 0;
+
+    // cut [0, count) into one block per thread, of equal cost if the costs are known
+    if (costs != NULL)
+    {
+        double total = 0.0, sum = 0.0;
+        int last = 0;
+
+        for (int i = 0; i < count; ++i)
+        {
+            total += (*costs)[i];
+        }
+
+        for (int t = 0; t < nrThreads; ++t)
+        {
+            double target = total * (double)(t + 1) / (double)nrThreads;
+
+            while (last < count && (t == nrThreads - 1 || sum + 0.5 * (*costs)[last] < target))
+            {
+                sum += (*costs)[last];
+                ++last;
+            }
+
+            queues[t].range = packRange(first, last);
+            queues[t].seeded = queues[t].range;
+            first = last;
+        }
+    }
+    else
+    {
+        for (int t = 0; t < nrThreads; ++t)
+        {
+            int last = (int)((long long)count * (t + 1) / nrThreads);
+
+            queues[t].range = packRange(first, last);
+            queues[t].seeded = queues[t].range;
+            first = last;
+        }
+    }
+
+    if (workers.empty())
+    {
+        currentTask = task;
+        currentContext = context;
+        runTasks(0);
+        elapsed += poolClock() - start;
+        return;
+    }
+
+    pthread_mutex_lock(&lock);
+    currentTask = task;
+    currentContext = context;
+    nrBusy = (int)workers.size();
+    ++round;
+    pthread_cond_broadcast(&wakeUp);
+    pthread_mutex_unlock(&lock);
+
+    runTasks(0);
+
+    pthread_mutex_lock(&lock);
+    while (nrBusy > 0)
+    {
+        pthread_cond_wait(&allDone, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+
+    elapsed += poolClock() - start;
+}
+
+// runs the thread's own block, then steals until nothing is left anywhere.
+// an item counts as stolen where it runs, if that is not the thread it was
+// seeded to; counting whole stolen ranges would count again what is stolen
+// from a thief
+void tThreadPool::runTasks(int thread)
+{
+    tWorkerStats &stats = queues[thread].stats;
+    int first = rangeFirst(queues[thread].seeded), last = rangeLast(queues[thread].seeded);
+    double start = poolClock();
+    int i;
+
+    while ((i = take(thread)) >= 0 || (i = steal(thread)) >= 0)
+    {
+        currentTask(i, thread, currentContext);
+        ++stats.tasks;
+
+        if (i < first || i >= last)
+        {
+            ++stats.stolen;
+        }
+    }
+
+    stats.busy += poolClock() - start;
+}
+
+// the next item from the front of the thread's own block, or -1
+int tThreadPool::take(int thread)
+{
+    uint64_t *range = &queues[thread].range;
+    uint64_t current = __atomic_load_n(range, __ATOMIC_ACQUIRE);
+
+    while (rangeFirst(current) < rangeLast(current))
+    {
+        if (__atomic_compare_exchange_n(range, &current, packRange(rangeFirst(current) + 1, rangeLast(current)), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            return rangeFirst(current);
+        }
+    }
+
+    return -1;
+}
+
+// moves the back half of the largest block left to this thread (whose own
+// block is empty) and returns its first item, or -1 once all blocks are empty.
+// items are only ever taken out of a block, so a thread that finds everything
+// empty can stop: whatever another thread has just stolen, it runs itself.
+int tThreadPool::steal(int thread)
+{
+    while (true)
+    {
+        int victim = -1, most = 0;
+        uint64_t current = 0;
+
+        for (int t = 0; t < (int)queues.size(); ++t)
+        {
+            uint64_t range = __atomic_load_n(&queues[t].range, __ATOMIC_ACQUIRE);
+
+            if (rangeLast(range) - rangeFirst(range) > most)
+            {
+                victim = t;
+                most = rangeLast(range) - rangeFirst(range);
+                current = range;
+            }
+        }
+
+        if (victim < 0)
+        {
+            return -1;
+        }
+
+        int first = rangeFirst(current), last = rangeLast(current);
+        int split = last - (last - first + 1) / 2;
+
+        if (__atomic_compare_exchange_n(&queues[victim].range, &current, packRange(first, split), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            __atomic_store_n(&queues[thread].range, packRange(split + 1, last), __ATOMIC_RELEASE);
+
+            return split;
+        }
+    }
+}
+
+void *tThreadPool::workerMain(void *arg)
+{
+    tWorkerInfo *info = (tWorkerInfo*)arg;
+    tThreadPool *pool = info->pool;
+    int seenRound = 0;
+
+    while (true)
+    {
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->shuttingDown && pool->round == seenRound)
+        {
+            pthread_cond_wait(&pool->wakeUp, &pool->lock);
+        }
+
+        if (pool->shuttingDown)
+        {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+
+        seenRound = pool->round;
+        pthread_mutex_unlock(&pool->lock);
+
+        pool->runTasks(info->thread);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->nrBusy == 0)
+        {
+            pthread_cond_signal(&pool->allDone);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    return NULL;
+}
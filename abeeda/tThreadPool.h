@@ -0,0 +1,97 @@
+/*
+ * tThreadPool.h
+ *
+ * This file is part of the Simon Memory Game project.
+ *
+ * Copyright 2012 Randal S. Olson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _tThreadPool_h_included_
+#define _tThreadPool_h_included_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <vector>
+
+using namespace std;
+
+// task run by the pool: index of the work item, index of the thread running it, shared context
+typedef void (*tPoolTask)(int index, int thread, void *context);
+
+// what one thread of the pool did since the last resetStats()
+class tWorkerStats{
+public:
+	double busy;
+	long long tasks, stolen;
+};
+
+// the part of the index range a thread still has to run, [first, last) packed
+// into one word so that the owner and a thief can both take from it by
+// compare-and-swap. padded so that no two threads share a cache line.
+class tWorkQueue{
+public:
+	uint64_t range;
+	// the block the thread started the loop with
+	uint64_t seeded;
+	tWorkerStats stats;
+	char padding[64];
+};
+
+// fixed set of worker threads that run parallel-for loops over an index range.
+// the calling thread takes part in every loop as thread 0.
+//
+// every thread starts on its own contiguous block of the range and runs it
+// front to back; a thread that runs out steals the back half of the largest
+// block left. given the cost of every item the blocks are cut to equal cost
+// instead of equal length, so that stealing only has to even out the error
+// of the estimate.
+class tThreadPool{
+public:
+	tThreadPool(int nrThreads);
+	~tThreadPool();
+	int size(void);
+	void parallelFor(int count, tPoolTask task, void *context);
+	void parallelFor(int count, tPoolTask task, void *context, const vector<double> &costs);
+
+	tWorkerStats stats(int thread);
+	double utilisation(int thread);
+	void resetStats(void);
+
+private:
+	vector<pthread_t> workers;
+	pthread_mutex_t lock;
+	pthread_cond_t wakeUp, allDone;
+	tPoolTask currentTask;
+	void *currentContext;
+	vector<tWorkQueue> queues;
+	double elapsed;
+	int round, nrBusy;
+	bool shuttingDown;
+
+	struct tWorkerInfo{
+		tThreadPool *pool;
+		int thread;
+	};
+	vector<tWorkerInfo> workerInfo;
+
+	static void *workerMain(void *arg);
+	void run(int count, tPoolTask task, void *context, const vector<double> *costs);
+	void runTasks(int thread);
+	int take(int thread);
+	int steal(int thread);
+};
+
+#endif